@@ -6,6 +6,11 @@
  * The actual functionality is implemented in separate modules:
  * - dfplayer.c: Audio control via DFPlayer Mini
  * - ibus.c: FlySky i-Bus protocol handling  
+ * - scheduler.c: 1ms tick and cooperative task scheduler
+ * - chmap.c: Division-free channel value mapping
+ * - actions.c: Table-driven channel-to-action rules
+ * - settings.c: Persistent settings in EEPROM
+ * - filemap.c: SD file name to file number map in EEPROM
  *
  * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
  * @license MIT License - see LICENSE file for details
@@ -15,6 +20,9 @@
 #include "src/config.h"
 #include "src/dfplayer.h"
 #include "src/ibus.h"
+#include "src/actions.h"
+#include "src/scheduler.h"
+#include "src/settings.h"
 
 /**
  * @brief Main application entry point
@@ -24,19 +32,31 @@ int main(void) {
     SYSTEM_Initialize();
     
     // Initialize application modules
+    scheduler_init();
+    settings_load();
     dfplayer_init();
+    dfplayer_request_volume(settings_get_volume());
     ibus_init();
+    actions_init();
     
     // Configure and play startup sequence
     dfplayer_startup_sequence();
+    actions_check_sdcard();
     
-    // Main application loop
+    // Continuously monitor i-Bus input and handle switch changes
+    scheduler_add(process_ibus_input, 0);
+    
+    // Send deferred DFPlayer commands as pacing allows
+    scheduler_add(dfplayer_task, 0);
+    
+    // Save changed settings to EEPROM in the background
+    scheduler_add(settings_task, 0);
+    
+    // Main application loop - tasks run to completion, nothing blocks;
+    // between passes the core idles until an interrupt brings new work
     while (1) {
-        // Continuously monitor i-Bus input and handle switch changes
-        process_ibus_input();
-        
-        // Use faster polling to keep up with data rate
-        __delay_ms(1); // 1ms delay for faster polling
+        scheduler_run();
+        scheduler_idle();
     }    
     
     return 0;
@@ -0,0 +1,33 @@
+/**
+ * @file action_rules.h
+ * @brief Channel-to-action mapping tables - edit to remap channels
+ *
+ * Only included by actions.c. Both tables live in ROM.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef ACTION_RULES_H
+#define ACTION_RULES_H
+
+#include "actions.h"
+#include "chmap.h"
+#include "playlists.h"
+
+// Channels debounced as switches, with their number of positions (2 or 3)
+static const action_switch_t action_switches[] = {
+    { 5, 3 },
+    { 6, 3 },
+};
+
+// Rules, sorted by channel (at most ACTION_MAX_RULES); rules with the
+// ACTION_ON_SCRIPT trigger are only fired by tools/triggers.txt
+static const action_rule_t action_rules[] = {
+    // channel, trigger,       action,          arg
+    { 5, ACTION_ON_CHANGE,     ACTION_PLAYLIST, PLAYLIST_ID_CH5 },
+    { 6, ACTION_ON_CHANGE,     ACTION_PLAYLIST, PLAYLIST_ID_CH6 },
+    { 7, ACTION_ON_LEVEL,      ACTION_VOLUME,   CHMAP_SCALE(30) },
+};
+
+#endif // ACTION_RULES_H
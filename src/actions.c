@@ -0,0 +1,216 @@
+/**
+ * @file actions.c
+ * @brief Table-driven channel-to-action mapping implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "actions.h"
+#include "action_rules.h"
+#include "dfplayer.h"
+#include "trigger_vm.h"
+#include "settings.h"
+
+#define TRIGGER_PROGRAM_LIMITS_ONLY
+#include "trigger_program.h"
+
+#define ACTION_RULE_COUNT (sizeof(action_rules) / sizeof(action_rules[0]))
+#define ACTION_SWITCH_COUNT (sizeof(action_switches) / sizeof(action_switches[0]))
+
+// Compile-time check: the rule table must fit the pending mask
+typedef char action_rules_fit_pending_mask[(ACTION_RULE_COUNT <= ACTION_MAX_RULES) ? 1 : -1];
+
+// Compile-time check: every fire(n) in the trigger script names an existing rule
+typedef char trigger_rules_exist[((int)TRIGGER_PROGRAM_MAX_RULE < (int)ACTION_RULE_COUNT) ? 1 : -1];
+
+#if PLAYLIST_COUNT > SETTINGS_PLAYLIST_SLOTS
+#error "Raise SETTINGS_PLAYLIST_SLOTS to remember every playlist position"
+#endif
+
+#if PLAYLIST_PLAY_BY_NAME
+#define PLAY_ENTRY(list, index) dfplayer_queue_play_name((list)->names[index])
+#else
+#define PLAY_ENTRY(list, index) dfplayer_queue_play_number((list)->numbers[index])
+#endif
+
+// Rules of channel c are action_rules[rule_first[c - 1]] .. [rule_first[c] - 1]
+static uint8_t rule_first[IBUS_CHANNELS + 1];
+static ibus_mask_t level_channels = 0;  // Channels with ACTION_ON_LEVEL rules
+
+static chmap_switch_t switch_state[ACTION_SWITCH_COUNT];
+static uint8_t playlist_pos[PLAYLIST_COUNT];   // Next file of each playlist
+static uint16_t pending = 0;                   // Rules waiting for pipeline room
+static uint8_t volume_level = DFPLAYER_VOLUME_DEFAULT;
+
+void actions_init(void) {
+    uint8_t channel;
+    uint8_t r = 0;
+    uint8_t i;
+    
+    // Pick up where the last session left off
+    volume_level = settings_get_volume();
+    for (i = 0; i < PLAYLIST_COUNT; i++) {
+        playlist_pos[i] = settings_get_playlist_pos(i);
+        if (playlist_pos[i] >= playlist_table[i].length) playlist_pos[i] = 0;
+    }
+    
+    // The table is sorted by channel, so each channel owns one contiguous run
+    for (channel = 1; channel <= IBUS_CHANNELS; channel++) {
+        rule_first[channel - 1] = r;
+        while (r < ACTION_RULE_COUNT && action_rules[r].channel == channel) {
+            if (action_rules[r].trigger == ACTION_ON_LEVEL) {
+                level_channels |= IBUS_CHANNEL_BIT(channel);
+            }
+            r++;
+        }
+    }
+    rule_first[IBUS_CHANNELS] = r;
+}
+
+void actions_check_sdcard(void) {
+    // Play-by-name does not depend on the card's order - nothing to check
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_PRO && !PLAYLIST_PLAY_BY_NAME
+    const dfplayer_status_t *status = dfplayer_status();
+    
+    // Numbered playlists follow the listing - flag a re-imaged card that was
+    // not followed by `make playlists` (the LED setting survives power-down,
+    // so startup turns it off again once the card matches)
+    if ((status->valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_FILES)) &&
+        status->total_files != PLAYLIST_SDCARD_FILE_COUNT) {
+        dfplayer_queue_command("AT+LED=ON\r\n", DFPLAYER_NO_ARG);
+    }
+#endif
+}
+
+// Mark the channel's rules that match an event (a position or ACTION_ON_LEVEL)
+static void action_match(uint8_t channel, uint8_t event) {
+    uint8_t r;
+    
+    for (r = rule_first[channel - 1]; r < rule_first[channel]; r++) {
+        uint8_t trigger = action_rules[r].trigger;
+        
+        if (trigger == event || (trigger == ACTION_ON_CHANGE && event != ACTION_ON_LEVEL)) {
+            pending |= (uint16_t)1 << r;
+        }
+    }
+}
+
+// Volume follows the channel; it must move past a level boundary by the
+// hysteresis band before the level changes
+static void action_volume(uint16_t value, uint8_t scale) {
+    uint8_t level = chmap_scale(value, scale);
+    
+    if (level > volume_level) {
+        level = chmap_scale(value - IBUS_VOLUME_HYSTERESIS, scale);
+    } else if (level < volume_level) {
+        level = chmap_scale(value + IBUS_VOLUME_HYSTERESIS, scale);
+    }
+    
+    if (level != volume_level) {
+        volume_level = level;
+        dfplayer_request_volume(level);
+        settings_set_volume(level);
+    }
+}
+
+// Carry out a rule; false if the command pipeline is full
+static bool action_execute(const action_rule_t *rule) {
+    switch (rule->action) {
+        case ACTION_PLAYLIST: {
+            const playlist_t *list = &playlist_table[rule->arg];
+            uint8_t *pos = &playlist_pos[rule->arg];
+            
+            if (!PLAY_ENTRY(list, *pos)) return false;
+            *pos = chmap_next(*pos, list->length);
+            settings_set_playlist_pos(rule->arg, *pos);
+            return true;
+        }
+        case ACTION_PLAY_FILE:
+            return dfplayer_queue_play_number(rule->arg);
+        case ACTION_VOLUME:
+            action_volume(get_channel_value(rule->channel), rule->arg);
+            return true;
+        case ACTION_STOP:
+            return dfplayer_queue_stop();
+        case ACTION_NEXT:
+            return dfplayer_queue_next();
+        default:
+            return true;
+    }
+}
+
+void actions_reset(void) {
+    uint8_t i;
+    ibus_mask_t levels = level_channels;
+    uint8_t channel;
+    
+    for (i = 0; i < ACTION_SWITCH_COUNT; i++) {
+        const action_switch_t *sw = &action_switches[i];
+        chmap_switch_reset(&switch_state[i], get_channel_value(sw->channel), sw->positions);
+    }
+    pending = 0;
+    
+    // Analog channels pick up their current value
+    for (channel = 1; levels; channel++, levels >>= 1) {
+        if (levels & 1) action_match(channel, ACTION_ON_LEVEL);
+    }
+}
+
+void actions_frame(ibus_mask_t changed) {
+    uint8_t i;
+    uint8_t channel;
+    ibus_mask_t edges = 0;
+    ibus_mask_t levels;
+    
+    // Switches are fed every frame so confirmation advances while they rest
+    for (i = 0; i < ACTION_SWITCH_COUNT; i++) {
+        const action_switch_t *sw = &action_switches[i];
+        
+        if (chmap_switch_update(&switch_state[i], get_channel_value(sw->channel), sw->positions)) {
+            edges |= IBUS_CHANNEL_BIT(sw->channel);
+            action_match(sw->channel, switch_state[i].position);
+        }
+    }
+    
+    // Analog channels only when they moved
+    levels = changed & level_channels;
+    for (channel = 1; levels; channel++, levels >>= 1) {
+        if (levels & 1) action_match(channel, ACTION_ON_LEVEL);
+    }
+    
+    // Conditional behaviour from the trigger script
+    trigger_vm_run(changed, edges);
+}
+
+void actions_fire(uint8_t rule) {
+    if (rule < ACTION_RULE_COUNT) pending |= (uint16_t)1 << rule;
+}
+
+uint8_t actions_switch_position(uint8_t channel) {
+    uint8_t i;
+    
+    for (i = 0; i < ACTION_SWITCH_COUNT; i++) {
+        if (action_switches[i].channel == channel) return switch_state[i].position;
+    }
+    return 0xFF;
+}
+
+void actions_cancel(void) {
+    pending = 0;
+}
+
+void actions_run_pending(void) {
+    uint8_t r;
+    uint16_t bit = 1;
+    
+    // Most passes have nothing pending - nothing more to do
+    if (pending == 0) return;
+    
+    // Keep an action pending while the pipeline is full
+    for (r = 0; r < ACTION_RULE_COUNT; r++, bit <<= 1) {
+        if ((pending & bit) && action_execute(&action_rules[r])) {
+            pending &= ~bit;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file actions.h
+ * @brief Table-driven channel-to-action mapping
+ *
+ * Rules in src/action_rules.h bind a channel event (a switch reaching a
+ * position, or an analog channel moving) to a DFPlayer action. Rules are
+ * evaluated once per decoded frame, and only for the channels that changed.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef ACTIONS_H
+#define ACTIONS_H
+
+#include "config.h"
+#include "ibus.h"
+
+#define ACTION_MAX_RULES 16  // Waiting rules are tracked in a 16-bit mask
+
+// Rule triggers
+#define ACTION_ON_POSITION(position) (position)  // Switch confirmed in position (0 = lowest)
+#define ACTION_ON_CHANGE 0xFF                    // Switch confirmed in any new position
+#define ACTION_ON_LEVEL 0xFE                     // Analog channel value changed
+#define ACTION_ON_SCRIPT 0xFD                    // Only fired by the trigger script
+
+/**
+ * @brief Rule actions (rule arg in brackets)
+ */
+typedef enum {
+    ACTION_PLAYLIST,   // Play the next file of a playlist [PLAYLIST_ID_<NAME>]
+    ACTION_PLAY_FILE,  // Play a file number [file number]
+    ACTION_VOLUME,     // Volume follows the channel [CHMAP_SCALE(top level)]
+    ACTION_STOP,       // Stop playback [unused]
+    ACTION_NEXT        // Skip to the next file [unused]
+} action_t;
+
+/**
+ * @brief One channel-to-action rule
+ */
+typedef struct {
+    uint8_t channel;   // 1-IBUS_CHANNELS
+    uint8_t trigger;   // ACTION_ON_POSITION(n), ACTION_ON_CHANGE or ACTION_ON_LEVEL
+    uint8_t action;    // action_t
+    uint8_t arg;       // Action argument
+} action_rule_t;
+
+/**
+ * @brief A channel debounced as a 2- or 3-position switch
+ */
+typedef struct {
+    uint8_t channel;   // 1-IBUS_CHANNELS
+    uint8_t positions; // 2 or 3
+} action_switch_t;
+
+/**
+ * @brief Index the rule table by channel
+ */
+void actions_init(void);
+
+/**
+ * @brief Check the SD card against the listing the playlists were generated from
+ * @note Call after dfplayer_startup_sequence(). If the DFPlayer reports a
+ *       different file count than PLAYLIST_SDCARD_FILE_COUNT, its LED is
+ *       turned on to flag that numbered playlists may play the wrong files
+ *       (DFPlayer Pro only - the Mini cannot report a count; skipped with
+ *       PLAYLIST_PLAY_BY_NAME, where playback does not follow the numbering)
+ */
+void actions_check_sdcard(void);
+
+/**
+ * @brief Re-establish switch positions without firing, and resync levels
+ * @note Call on the first frame after power-up or failsafe
+ */
+void actions_reset(void);
+
+/**
+ * @brief Evaluate the rules for a decoded frame
+ * @param changed Channels whose value changed in this frame
+ */
+void actions_frame(ibus_mask_t changed);
+
+/**
+ * @brief Queue a rule's action regardless of its trigger (trigger script hook)
+ * @param rule Index into the rule table; out of range indices are ignored
+ */
+void actions_fire(uint8_t rule);
+
+/**
+ * @brief Get the confirmed position of a switch channel
+ * @param channel Channel number (1-IBUS_CHANNELS)
+ * @return Position (0 = lowest), or 0xFF if the channel is not a switch
+ */
+uint8_t actions_switch_position(uint8_t channel);
+
+/**
+ * @brief Drop actions still waiting for room in the command pipeline
+ */
+void actions_cancel(void);
+
+/**
+ * @brief Hand waiting actions to the command pipeline (call every pass)
+ */
+void actions_run_pending(void);
+
+#endif // ACTIONS_H
@@ -0,0 +1,70 @@
+/**
+ * @file chmap.c
+ * @brief Division-free channel value mapping helpers implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "chmap.h"
+
+uint8_t chmap_scale(uint16_t value, uint8_t scale) {
+    if (value <= CHMAP_MIN) return 0;
+    if (value > CHMAP_MAX) value = CHMAP_MAX;
+    
+    // 0..250 after the shift, so the product fits 16 bits (8x16 shift-add)
+    return (uint8_t)(((uint16_t)((value - CHMAP_MIN) >> 2) * scale) >> 10);
+}
+
+uint8_t chmap_next(uint8_t index, uint8_t length) {
+    index++;
+    if (index >= length) index = 0;
+    return index;
+}
+
+// Classify a value into a switch position. Band edges move away from the
+// current position by CHMAP_SWITCH_HYSTERESIS, so noise at an edge cannot
+// flip between positions.
+static uint8_t chmap_classify(uint16_t value, uint8_t positions, uint8_t current) {
+    uint8_t position = 0;
+    uint16_t edge = (positions == 3) ? 1250 : 1500;
+    
+    do {
+        if (current > position) {
+            if (value < edge - CHMAP_SWITCH_HYSTERESIS) break;
+        } else {
+            if (value <= edge + CHMAP_SWITCH_HYSTERESIS) break;
+        }
+        position++;
+        edge += 500;
+    } while (position < positions - 1);
+    
+    return position;
+}
+
+void chmap_switch_reset(chmap_switch_t *sw, uint16_t value, uint8_t positions) {
+    // No hysteresis reference yet - classify from the middle position
+    sw->position = chmap_classify(value, positions, positions >> 1);
+    sw->candidate = sw->position;
+    sw->count = 0;
+}
+
+bool chmap_switch_update(chmap_switch_t *sw, uint16_t value, uint8_t positions) {
+    uint8_t position = chmap_classify(value, positions, sw->position);
+    
+    if (position == sw->position) {
+        sw->count = 0;  // Back in place - a glitch, not a move
+        return false;
+    }
+    if (position != sw->candidate) {
+        sw->candidate = position;
+        sw->count = 1;
+    } else if (sw->count < CHMAP_SWITCH_CONFIRM_FRAMES) {
+        sw->count++;
+    }
+    if (sw->count < CHMAP_SWITCH_CONFIRM_FRAMES) return false;
+    
+    sw->position = position;
+    sw->count = 0;
+    return true;
+}
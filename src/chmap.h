@@ -0,0 +1,79 @@
+/**
+ * @file chmap.h
+ * @brief Division-free channel value mapping helpers
+ *
+ * The PIC16 core has no multiplier or divider, so every '/' and '%' on the
+ * hot path becomes a software library call. These helpers map channel
+ * values with shift-based fixed point and wrap counters with compare-and-reset.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef CHMAP_H
+#define CHMAP_H
+
+#include "config.h"
+
+#define CHMAP_MIN 1000  // Channel value mapped to 0
+#define CHMAP_MAX 2000  // Channel value mapped to the top of the range
+
+/**
+ * @brief Debounced switch state (see chmap_switch_update)
+ */
+typedef struct {
+    uint8_t position;   // Confirmed position, 0 = lowest
+    uint8_t candidate;  // Position seen in the last frame(s)
+    uint8_t count;      // Consecutive frames the candidate has held
+} chmap_switch_t;
+
+/**
+ * @brief Fixed-point scale factor for chmap_scale(), folded at compile time
+ * @param top Highest output level (1-62)
+ *
+ * Output = ((value - CHMAP_MIN) >> 2) * scale >> 10. Rounding the factor up
+ * makes CHMAP_MAX land exactly on top, and 250 * scale stays within 16 bits.
+ * The factor must fit the uint8_t scale: top 62 gives 254, top 63 would need
+ * 259 and silently truncate.
+ */
+#define CHMAP_SCALE(top) ((uint8_t)(((top) * 1024u + 249u) / 250u))
+
+/**
+ * @brief Map a channel value linearly onto 0..top
+ * @param value Channel value in µs (clamped to CHMAP_MIN..CHMAP_MAX)
+ * @param scale CHMAP_SCALE(top)
+ * @return Level in 0..top
+ * @note Boundaries sit within 4µs of the exact (value - 1000) * top / 1000
+ */
+uint8_t chmap_scale(uint16_t value, uint8_t scale);
+
+/**
+ * @brief Advance a wrapping index
+ * @param index Current index (0..length-1)
+ * @param length Number of entries
+ * @return index + 1, or 0 after the last entry
+ */
+uint8_t chmap_next(uint8_t index, uint8_t length);
+
+/**
+ * @brief Set a switch to the position of a value without reporting an edge
+ * @param sw Switch state
+ * @param value Channel value in us
+ * @param positions 2 or 3
+ * @note Used on the first frame after power-up or failsafe
+ */
+void chmap_switch_reset(chmap_switch_t *sw, uint16_t value, uint8_t positions);
+
+/**
+ * @brief Feed one frame's value to a debounced switch
+ * @param sw Switch state
+ * @param value Channel value in us
+ * @param positions 2 (edge at 1500) or 3 (edges at 1250 and 1750)
+ * @return true once a new position has held for CHMAP_SWITCH_CONFIRM_FRAMES
+ *         consecutive frames (sw->position then holds it)
+ * @note Call for every frame, not only when the value changed, so the
+ *       confirmation count advances while the switch rests
+ */
+bool chmap_switch_update(chmap_switch_t *sw, uint16_t value, uint8_t positions);
+
+#endif // CHMAP_H
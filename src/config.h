@@ -15,13 +15,96 @@
 
 // Note: _XTAL_FREQ is already defined by MCC in clock.h
 
+// RAM budget (256 bytes): the defaults below take ~197 bytes of statics, ~25
+// for the deepest call path (DFPlayer boot) and ~10 for the ISR, leaving
+// ~24 bytes of headroom. These are hand counts - confirm with the XC8 memory
+// summary after changing a size knob. Each knob notes its RAM cost; the
+// changes noted together must stay within the headroom
+
 // i-Bus configuration
 #define IBUS_BUFFER_SIZE 32
 #define IBUS_PACKET_SIZE 32
-#define IBUS_CHANNELS 14
+// Channels decoded, from channel 1: cover every channel in action_rules.h and
+// the trigger script; 18 adds nibble-packed 15-18
+// RAM: 7 bytes per channel, so at most 11 within the headroom; above 16 the
+// change masks also double to 32 bits. 14 or 18 do not fit with the defaults
+#define IBUS_CHANNELS 8
+
+// Treat an RX idle gap as the frame boundary instead of hunting for 0x20 0x40.
+// Bytes within a frame are ~87us apart; frames are separated by ~7ms idle.
+#define IBUS_GAP_FRAMING 1
+#define IBUS_FRAME_GAP_US 500
+
+// Link statistics for ibus_get_stats() (1 = on, costs 23 bytes of RAM - fits
+// only with IBUS_CHANNELS 8 and no other knob raised)
+#define IBUS_STATS 0
+
+// A volume channel must move this far (us) past a level boundary to change volume
+#define IBUS_VOLUME_HYSTERESIS 8
+
+// Failsafe: with no valid frame for this long report the failsafe values and
+// ignore switch and volume changes until frames return. Entering failsafe drops
+// confirmed triggers not yet sent, so the default rides out ~14 lost frames;
+// 21 (3 frame periods, 1ms tick jitter included) is the lowest supported
+#define IBUS_FAILSAFE_TIMEOUT_MS 100
+#define IBUS_FAILSAFE_TRACK 0  // File played on entering failsafe (0 = none)
+// Values reported in failsafe, channel 1 first; unlisted channels report 1500
+#define IBUS_FAILSAFE_VALUES { 1500, 1500, 1000, 1500, 1000, 1000, 1000 }
+
+// Switch channels (see src/action_rules.h) are classified into positions
+// (2 or 3; bands centred on 1000/1500/2000) and a new position must hold for
+// CHMAP_SWITCH_CONFIRM_FRAMES consecutive frames before it triggers
+#define CHMAP_SWITCH_HYSTERESIS 50     // us past a band edge to leave a position
+#define CHMAP_SWITCH_CONFIRM_FRAMES 3
+
+// Trigger script VM (tools/triggers.txt, compiled by tools/trigger_compile.py)
+#define TRIGGER_VM_MAX_STEPS 48  // Per-frame instruction budget
+#define TRIGGER_VM_VARS 4        // Most 16-bit script variables (RAM: 2 bytes per variable used)
+#define TRIGGER_VM_STACK 4       // Deepest 16-bit evaluation stack allowed (2 bytes per level)
+
+// Persistent settings (volume, playlist positions) in data EEPROM
+#define SETTINGS_EEPROM_BASE 0x00      // Wear-levelled record ring
+#define SETTINGS_EEPROM_SIZE 128
+#define SETTINGS_PLAYLIST_SLOTS 4      // Playlist positions kept (>= PLAYLIST_COUNT, 1 byte each)
+#define SETTINGS_SAVE_DELAY_MS 2000    // Save once values have been stable this long
+
+// File name map (DFPlayer Pro): play-by-name goes out as AT+PLAYNUM=n
+// Rebuilt by a muted startup scan whenever the SD card file count changes
+#define FILEMAP_ENABLE PLAYLIST_PLAY_BY_NAME  // Only play-by-name builds use it (~11 bytes)
+#define FILEMAP_EEPROM_BASE 0x80       // After the settings ring
+#define FILEMAP_EEPROM_SIZE 128        // Up to 63 files
+
+// Scheduler configuration
+#define SCHEDULER_MAX_TASKS 3  // main() adds 3 tasks (6 bytes per slot)
+#define SCHEDULER_IDLE 1    // Idle the CPU between wake-up events (0 = busy loop)
 
 // DFPlayer configuration
+#define DFPLAYER_BACKEND_PRO 0   // DFPlayer Pro, ASCII AT commands with OK acks
+#define DFPLAYER_BACKEND_MINI 1  // DFPlayer Mini (and clones), 10-byte binary frames
+#define DFPLAYER_BACKEND DFPLAYER_BACKEND_PRO
+#define DFPLAYER_MINI_CMD_GAP_MS 30   // Mini runs without feedback - fixed gap per command
+#define DFPLAYER_MINI_BOOT_MS 1500    // Mini SD card init time before the first command
 #define DFPLAYER_VOLUME_DEFAULT 6
-#define DFPLAYER_STARTUP_DELAY 3000
+#define DFPLAYER_STARTUP_TIMEOUT 3000  // Give up probing for the DFPlayer after this
+#define DFPLAYER_PROBE_INTERVAL_MS 50  // Resend AT while waiting for first OK
+#define DFPLAYER_ACK_TIMEOUT_MS 200    // Send the next command anyway after this
+// TX queue: "AT+PLAYNUM=255\r\n" fits 15 queued bytes plus the two the EUSART holds,
+// so number commands never wait. The rare unmapped "AT+PLAYFILE=/name.mp3\r\n" (27)
+// waits ~1ms for the EUSART to drain the rest
+#define DFPLAYER_TX_QUEUE_SIZE 16  // Must be a power of two (32 costs 16 more bytes)
+// Longest reply used: an 8.3 file name, "/NAME0001.MP3\r\n"
+// RAM: twice this - the receive line plus the boot sequence's copy
+#define DFPLAYER_RX_LINE_SIZE 16
+#define DFPLAYER_FILE_NAME_SIZE 0  // Cache the playing file's name in this many bytes of RAM (0 = off)
+// Re-query playback status (0 = off; the Pro's stop then cannot tell that a
+// file already finished, and dfplayer_is_playing() always reports false)
+#define DFPLAYER_STATUS_REFRESH_MS 1000
+// Commands waiting for the pipeline; actions retry when full (3 bytes each, any size)
+#define DFPLAYER_CMD_QUEUE_SIZE 2
+
+// Playlists (src/playlists.h is generated - see tools/playlist_gen.py)
+// 0 = trigger with AT+PLAYNUM=n (short, needs the SD card listing to match)
+// 1 = trigger with AT+PLAYFILE=/name.mp3 (independent of SD card order)
+#define PLAYLIST_PLAY_BY_NAME 0
 
 #endif // CONFIG_H
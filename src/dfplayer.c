@@ -1,225 +1,695 @@
 /**
  * @file dfplayer.c
- * @brief DFPlayer Mini audio module control implementation
+ * @brief DFPlayer Pro / DFPlayer Mini audio module control implementation
  *
  * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
  * @license MIT License - see LICENSE file for details
  */
 
 #include "dfplayer.h"
+#include "scheduler.h"
+#include "filemap.h"
+#include <string.h>
 #include "../mcc_generated_files/system/system.h"
-#include "../mcc_generated_files/timer/delay.h"
 
 // Forward declaration for static function
-static uint8_t dfplayer_read_byte(void);
 static void dfplayer_send_number(uint8_t number);
 
+// Software UART receiver on RA2 (9600 baud, 104us per bit)
+// IOC catches the start bit edge, then Timer2 (8MHz Fosc/4 / 16 = 2us ticks,
+// period PR2 + 1 ticks) interrupts at the centre of each data bit.
+#define SOFT_RX_FIRST_PERIOD 77   // 78 ticks: 1.5 bit times (156us) to centre of bit 0
+#define SOFT_RX_BIT_PERIOD 51     // 52 ticks: 1 bit time (104us)
+#define SOFT_RX_T2CON_RUN 0x06    // TMR2ON, 1:16 prescale, 1:1 postscale
+#define SOFT_RX_T2CON_STOP 0x02
+
+static volatile char rx_line[DFPLAYER_RX_LINE_SIZE];
+static volatile uint8_t rx_len = 0;
+static volatile bool rx_line_ready = false;  // Set by ISR on '\n', cleared by reader
+static uint8_t rx_shift = 0;                 // ISR only
+static uint8_t rx_bit = 0;                   // ISR only
+
+// TX queue drained by the EUSART TX interrupt
+#define TX_QUEUE_MASK (DFPLAYER_TX_QUEUE_SIZE - 1)
+static volatile uint8_t tx_queue[DFPLAYER_TX_QUEUE_SIZE];
+static volatile uint8_t tx_head = 0;  // Written by main loop only
+static volatile uint8_t tx_tail = 0;  // Written by ISR only
+
+// Command pipeline: one command in flight at a time; the next one goes out
+// as soon as the DFPlayer answers the previous one (or the ack times out)
+#define EXPECT_NONE 0      // Nothing in flight
+#define EXPECT_OK 0xFF     // Waiting for "OK" (query ids 1-5 wait for an answer)
+#define EXPECT_GAP 0xFE    // Waiting out a fixed gap (no acks from the Mini)
+
+#define ARG_FILE_NAME 0xFE  // text is a packed DFPLAYER_NAME_SIZE base name
+
+#define ARG_FRAME 0xFD      // text is a DFMINI_FRAME_SIZE binary frame
+
+// Only the Pro reports file names back for the startup scan
+#define DFPLAYER_FILEMAP (FILEMAP_ENABLE && DFPLAYER_BACKEND == DFPLAYER_BACKEND_PRO)
+
+typedef struct {
+    const char* text;      // Command line, prefix, packed name, frame, or NULL to play arg
+    uint8_t arg;           // Number, DFPLAYER_NO_ARG, ARG_FILE_NAME or ARG_FRAME
+} dfplayer_cmd_t;
+
+static dfplayer_cmd_t cmd_queue[DFPLAYER_CMD_QUEUE_SIZE];
+static uint8_t cmd_head = 0;
+static uint8_t cmd_count = 0;
+static uint8_t in_flight = EXPECT_NONE;
+static uint16_t ack_deadline = 0;
+static uint16_t ack_timeouts = 0;
+
+// Coalescing volume slot - last writer wins
+static uint8_t volume_target = DFPLAYER_VOLUME_DEFAULT;
+static uint8_t volume_sent = DFPLAYER_VOLUME_DEFAULT;
+
+// Asynchronous queries: requested (bitmask) -> in flight -> answered (cache)
+static uint8_t query_requested = 0;
+static dfplayer_status_t status;
+
+// Stop sent and no file started since; the Pro's AT+PLAY=PP toggles, so a
+// second stop must not go out or it would resume playback
+static bool paused = false;
+
 void dfplayer_init(void) {
-    // DFPlayer is initialized through EUSART, no additional setup needed
-    // RA2 is already configured as digital input with pull-up via MCC
+    // TX uses the EUSART; RA2 is already a digital input with pull-up via MCC
+    
+    // Timer2 paces bit sampling for the software receiver (stopped until a start bit)
+    T2CON = SOFT_RX_T2CON_STOP;
+    PIR1bits.TMR2IF = 0;
+    PIE1bits.TMR2IE = 1;
+    
+    // Falling edge on RA2 marks a start bit
+    IOCAFbits.IOCAF2 = 0;
+    IOCANbits.IOCAN2 = 1;
+    PIE0bits.IOCIE = 1;
 }
 
-// Software UART receiver for DFPlayer responses on RA2
-// Simple implementation for 9600 baud (104μs per bit)
-uint8_t dfplayer_read_response(char* buffer, uint8_t max_len) {
-    uint8_t byte_count = 0;
-    uint16_t timeout_counter;
+void dfplayer_rx_edge_isr(void) {
+    IOCAFbits.IOCAF2 = 0;
     
-    // Wait for start bit (falling edge) with timeout
-    timeout_counter = 0;
-    while (IO_RA2_GetValue() == 1 && timeout_counter < 10000) {
-        DELAY_microseconds(10);
-        timeout_counter++;
-    }
+    // Ignore further edges until the byte is in; sample from the timer
+    IOCANbits.IOCAN2 = 0;
+    rx_bit = 0;
+    TMR2 = 0;
+    PR2 = SOFT_RX_FIRST_PERIOD;
+    PIR1bits.TMR2IF = 0;
+    T2CON = SOFT_RX_T2CON_RUN;
+}
+
+void dfplayer_rx_bit_isr(void) {
+    PIR1bits.TMR2IF = 0;
     
-    if (timeout_counter >= 10000) return 0; // Timeout - no data
+    if (rx_bit == 0) {
+        PR2 = SOFT_RX_BIT_PERIOD;  // Remaining bits are one bit time apart
+    }
     
-    // Read bytes until we get \r\n or buffer full
-    while (byte_count < (max_len - 1)) {
-        uint8_t received_byte = dfplayer_read_byte();
-        
-        if (received_byte == 0) break; // Error or timeout
-        
-        buffer[byte_count] = received_byte;
-        byte_count++;
-        
-        // Check for end of response
-        if (byte_count >= 2 && 
-            buffer[byte_count-2] == '\r' && 
-            buffer[byte_count-1] == '\n') {
-            break;
-        }
+    // Sample data bits LSB first
+    rx_shift >>= 1;
+    if (IO_RA2_GetValue()) {
+        rx_shift |= 0x80;
     }
     
-    buffer[byte_count] = '\0'; // Null terminate
-    return byte_count;
-}
-
-// Read a single byte using software UART on RA2 (9600 baud)
-static uint8_t dfplayer_read_byte(void) {
-    uint8_t byte = 0;
-    uint8_t bit_count;
+    if (++rx_bit < 8) return;
     
-    // Wait for start bit (should already be low)
-    if (IO_RA2_GetValue() == 1) return 0; // No start bit
+    // Byte complete - line idles high through the stop bit, rearm start detection
+    T2CON = SOFT_RX_T2CON_STOP;
+    IOCAFbits.IOCAF2 = 0;
+    IOCANbits.IOCAN2 = 1;
     
-    DELAY_microseconds(52); // Wait to center of start bit (half bit time)
+    // Skip null bytes (padding / Unicode encoding in filename responses) and
+    // hold off while the reader still owns a finished line
+    if (rx_shift == 0 || rx_line_ready) return;
     
-    // Sample 8 data bits (LSB first)
-    for (bit_count = 0; bit_count < 8; bit_count++) {
-        DELAY_microseconds(104); // One bit time at 9600 baud
-        
-        if (IO_RA2_GetValue()) {
-            byte |= (1 << bit_count); // Set bit if line is high
-        }
+    if (rx_len < DFPLAYER_RX_LINE_SIZE - 1) {
+        rx_line[rx_len++] = rx_shift;
+    }
+    if (rx_shift == '\n') {
+        rx_line_ready = true;
+        scheduler_wake();
     }
+}
+
+// Copy a completed response line out of the receiver and release it
+static uint8_t dfplayer_take_line(char* buffer, uint8_t max_len) {
+    uint8_t byte_count = 0;
     
-    DELAY_microseconds(104); // Wait through stop bit
+    if (!rx_line_ready) return 0;  // Nothing complete yet
     
-    return byte;
+    while (byte_count < rx_len && byte_count < (max_len - 1)) {
+        buffer[byte_count] = rx_line[byte_count];
+        byte_count++;
+    }
+    buffer[byte_count] = '\0'; // Null terminate
+    
+    rx_len = 0;
+    rx_line_ready = false;
+    return byte_count;
+}
+
+uint8_t dfplayer_read_response(char* buffer, uint8_t max_len) {
+    return dfplayer_take_line(buffer, max_len);
 }
 
 // Helper function to send a number as ASCII digits (no zero padding)
+// Compare-and-subtract per decade - no software divide on this core
 static void dfplayer_send_number(uint8_t number) {
-    char buffer[4]; // Max 3 digits + null terminator
-    uint8_t i = 0;
+    static const uint8_t decades[] = {100, 10};
+    uint8_t i;
+    bool leading = true;
     
-    // Convert number to string (simple approach)
-    if (number == 0) {
-        dfplayer_send_byte('0');
-    } else {
-        // Build string in reverse, then send forward
-        uint8_t temp = number;
-        while (temp > 0) {
-            buffer[i++] = '0' + (temp % 10);
-            temp /= 10;
+    for (i = 0; i < sizeof(decades); i++) {
+        char digit = '0';
+        while (number >= decades[i]) {
+            number -= decades[i];
+            digit++;
         }
-        // Send digits in correct order (reverse of how we built them)
-        while (i > 0) {
-            dfplayer_send_byte(buffer[--i]);
+        if (digit != '0' || !leading) {
+            dfplayer_send_byte(digit);
+            leading = false;
         }
     }
+    dfplayer_send_byte('0' + number);
 }
 
-// Read filename response, filtering out null bytes
+// Null bytes are already filtered by the receiver
 uint8_t dfplayer_read_filename(char* buffer, uint8_t max_len) {
-    uint8_t byte_count = 0;
-    uint16_t timeout_counter;
+    return dfplayer_take_line(buffer, max_len);
+}
+
+void dfplayer_send_string(const char* str) {
+    while (*str) {
+        dfplayer_send_byte(*str++);
+    }
+}
+
+void dfplayer_send_byte(char byte) {
+    uint8_t next_head = (tx_head + 1) & TX_QUEUE_MASK;
+    
+    // Queue full - wait for the ISR to make room
+    while (next_head == tx_tail);
+    
+    tx_queue[tx_head] = byte;
+    tx_head = next_head;
+    
+    // Kick the TX interrupt; the ISR disables it again once drained
+    PIE1bits.TXIE = 1;
+}
+
+uint8_t dfplayer_tx_free(void) {
+    return (uint8_t)(tx_tail - tx_head - 1) & TX_QUEUE_MASK;
+}
+
+bool dfplayer_tx_idle(void) {
+    return tx_head == tx_tail;
+}
+
+void dfplayer_request_volume(uint8_t volume) {
+    if (volume > 30) volume = 30;  // Clamp to maximum volume
+    volume_target = volume;
+}
+
+// Parse the first decimal number in a response line
+static uint16_t dfplayer_parse_number(const char* ptr) {
+    uint16_t value = 0;
     
-    // Wait for start bit (falling edge) with timeout
-    timeout_counter = 0;
-    while (IO_RA2_GetValue() == 1 && timeout_counter < 10000) {
-        DELAY_microseconds(10);
-        timeout_counter++;
+    // Skip any leading whitespace or non-digit characters
+    while (*ptr && (*ptr < '0' || *ptr > '9')) {
+        ptr++;
     }
     
-    if (timeout_counter >= 10000) return 0; // Timeout - no data
+    // Extract number
+    while (*ptr >= '0' && *ptr <= '9') {
+        value = value * 10 + (*ptr - '0');
+        ptr++;
+    }
+    return value;
+}
+
+// Store a response line in the cache slot of the query it answers
+static void dfplayer_store_answer(uint8_t query, const char* line, uint8_t len) {
+#if DFPLAYER_FILE_NAME_SIZE
+    uint8_t i;
+#else
+    (void)len;
+#endif
     
-    // Read bytes until we get \r\n or buffer full
-    while (byte_count < (max_len - 1)) {
-        uint8_t received_byte = dfplayer_read_byte();
-        
-        if (received_byte == 0) {
-            // Skip null bytes - they might be padding or Unicode encoding
-            continue;
-        }
-        
-        buffer[byte_count] = received_byte;
-        byte_count++;
-        
-        // Check for end of response
-        if (byte_count >= 2 && 
-            buffer[byte_count-2] == '\r' && 
-            buffer[byte_count-1] == '\n') {
+    switch (query) {
+        case DFPLAYER_QUERY_CURRENT_FILE:
+            status.current_file = dfplayer_parse_number(line);
+            break;
+        case DFPLAYER_QUERY_TOTAL_FILES:
+            status.total_files = dfplayer_parse_number(line);
+            break;
+        case DFPLAYER_QUERY_ELAPSED_TIME:
+            status.elapsed_time = dfplayer_parse_number(line);
+            break;
+        case DFPLAYER_QUERY_TOTAL_TIME:
+            status.total_time = dfplayer_parse_number(line);
             break;
+        default:
+#if DFPLAYER_FILE_NAME_SIZE
+            // File name without the trailing "\r\n"
+            while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == '\n')) {
+                len--;
+            }
+            if (len > DFPLAYER_FILE_NAME_SIZE - 1) len = DFPLAYER_FILE_NAME_SIZE - 1;
+            for (i = 0; i < len; i++) {
+                status.file_name[i] = line[i];
+            }
+            status.file_name[len] = '\0';
+            break;
+#else
+            return;  // Not cached
+#endif
+    }
+    status.valid |= DFPLAYER_STATUS_BIT(query);
+}
+
+// Match a received line to the command in flight
+static void dfplayer_poll_responses(void) {
+    char line[DFPLAYER_RX_LINE_SIZE];
+    uint8_t len;
+    bool is_ack;
+    
+    if (in_flight == EXPECT_NONE) {
+        // Nothing outstanding - drop unsolicited lines
+        dfplayer_read_response(line, sizeof(line));
+        return;
+    }
+    
+    if (in_flight == EXPECT_GAP) {
+        if (scheduler_deadline_reached(ack_deadline)) in_flight = EXPECT_NONE;
+        return;
+    }
+    
+    len = dfplayer_read_response(line, sizeof(line));
+    if (len == 0) {
+        // Fall back to a timeout so a lost ack can't stall the pipeline
+        if (scheduler_deadline_reached(ack_deadline)) {
+            ack_timeouts++;
+            in_flight = EXPECT_NONE;
         }
+        return;
     }
     
-    buffer[byte_count] = '\0'; // Null terminate
-    return byte_count;
+    is_ack = (line[0] == 'O' && line[1] == 'K') || (line[0] == 'E' && line[1] == 'R');
+    if (in_flight == EXPECT_OK) {
+        if (is_ack) in_flight = EXPECT_NONE;
+        return;
+    }
+    
+    // A query is answered by its value line (an error also ends it)
+    if (!is_ack) {
+        dfplayer_store_answer(in_flight, line, len);
+    }
+    in_flight = EXPECT_NONE;
 }
 
-void dfplayer_send_string(const char* str) {
-    while (*str) {
-        while (!EUSART_IsTxReady());
-        EUSART_Write(*str++);
+// Mark a just-sent command as in flight
+static void dfplayer_expect(uint8_t expect) {
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+    // The Mini runs without feedback frames - pace on a fixed gap instead
+    (void)expect;
+    in_flight = EXPECT_GAP;
+    ack_deadline = scheduler_millis() + DFPLAYER_MINI_CMD_GAP_MS;
+#else
+    in_flight = expect;
+    ack_deadline = scheduler_millis() + DFPLAYER_ACK_TIMEOUT_MS;
+#endif
+}
+
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_PRO
+// Send the lowest-numbered requested query (the Mini has no query support)
+static void dfplayer_send_query(void) {
+    uint8_t query = DFPLAYER_QUERY_CURRENT_FILE;
+    
+    while (!(query_requested & DFPLAYER_STATUS_BIT(query))) {
+        query++;
     }
+    query_requested &= ~DFPLAYER_STATUS_BIT(query);
+    
+    dfplayer_send_string("AT+QUERY=");
+    dfplayer_send_byte('0' + query);
+    dfplayer_send_string("\r\n");
+    dfplayer_expect(query);
 }
+#endif
 
-void dfplayer_send_byte(char byte) {
-    while (!EUSART_IsTxReady());
-    EUSART_Write(byte);
+bool dfplayer_queue_command(const char* text, uint8_t arg) {
+    dfplayer_cmd_t* cmd;
+    uint8_t tail;
+    
+    if (cmd_count >= DFPLAYER_CMD_QUEUE_SIZE) return false;
+    
+    // Compare-and-reset wrap - no software modulo on this core
+    tail = cmd_head + cmd_count;
+    if (tail >= DFPLAYER_CMD_QUEUE_SIZE) tail -= DFPLAYER_CMD_QUEUE_SIZE;
+    cmd = &cmd_queue[tail];
+    cmd->text = text;
+    cmd->arg = arg;
+    cmd_count++;
+    return true;
 }
 
-void dfplayer_startup_sequence(void) {
-    DELAY_milliseconds(DFPLAYER_STARTUP_DELAY);
+bool dfplayer_queue_play_number(uint8_t file_number) {
+    // Dispatched through dfplayer_play_file_number() for the active backend
+    if (!dfplayer_queue_command(NULL, file_number)) return false;
+    paused = false;
+    return true;
+}
 
-    // Configure DFPlayer settings
-    dfplayer_send_string("AT+LED=OFF\r\n");     // Turn off LED indicator
-    DELAY_milliseconds(1000);
+bool dfplayer_queue_frame(const uint8_t* frame) {
+    return dfplayer_queue_command((const char*)frame, ARG_FRAME);
+}
 
-    dfplayer_send_string("AT+VOL=");
-    dfplayer_send_number(DFPLAYER_VOLUME_DEFAULT);
-    dfplayer_send_string("\r\n");
-    DELAY_milliseconds(1000);
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+bool dfplayer_queue_next(void) {
+    static const uint8_t frame_next[] = DFMINI_FRAME(DFMINI_CMD_NEXT, 0);
+    return dfplayer_queue_frame(frame_next);
+}
 
-    // Set to play one song and pause
-    dfplayer_send_string("AT+PLAYMODE=3\r\n");
-    DELAY_milliseconds(1000);
+bool dfplayer_queue_stop(void) {
+    static const uint8_t frame_stop[] = DFMINI_FRAME(DFMINI_CMD_STOP, 0);
+    if (!dfplayer_queue_frame(frame_stop)) return false;
+    paused = true;
+    return true;
+}
+#else
+bool dfplayer_queue_next(void) {
+    if (!dfplayer_queue_command("AT+PLAY=NEXT\r\n", DFPLAYER_NO_ARG)) return false;
+    paused = false;
+    return true;
+}
+
+bool dfplayer_queue_stop(void) {
+    // PP toggles - pause once, and leave a file the cache shows as finished.
+    // Without DFPLAYER_STATUS_REFRESH_MS the cache stays empty and the last
+    // file started is taken to be playing
+    if (paused) return true;
+    if ((status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_ELAPSED_TIME)) &&
+        (status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_TIME)) &&
+        status.elapsed_time >= status.total_time) {
+        return true;
+    }
+    if (!dfplayer_queue_command("AT+PLAY=PP\r\n", DFPLAYER_NO_ARG)) return false;
+    paused = true;
+    return true;
+}
+#endif
+
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+// Send a binary frame with a runtime argument
+static void dfplayer_send_mini(uint8_t cmd, uint16_t param) {
+    uint16_t checksum = DFMINI_CHECKSUM(cmd, param);
     
-    // Play the startup file
-    // dfplayer_send_string("AT+PLAYFILE=/startup.mp3\r\n");
-    dfplayer_play_file_number(1);
-    DELAY_milliseconds(2000);
+    dfplayer_send_byte(0x7E);
+    dfplayer_send_byte(0xFF);
+    dfplayer_send_byte(0x06);
+    dfplayer_send_byte(cmd);
+    dfplayer_send_byte(0x00);  // No feedback
+    dfplayer_send_byte(param >> 8);
+    dfplayer_send_byte(param & 0xFF);
+    dfplayer_send_byte(checksum >> 8);
+    dfplayer_send_byte(checksum & 0xFF);
+    dfplayer_send_byte(0xEF);
 }
+#endif
 
-uint8_t dfplayer_get_total_files(void) {
-    char response[16];
-    uint8_t len;
+// Send a precomputed binary frame
+static void dfplayer_send_frame(const uint8_t* frame) {
+    uint8_t i;
     
-    // Send query command
-    dfplayer_send_string("AT+QUERY=2\r\n");
-    DELAY_milliseconds(100); // Give DFPlayer time to respond
+    for (i = 0; i < DFMINI_FRAME_SIZE; i++) {
+        dfplayer_send_byte(frame[i]);
+    }
+}
+
+bool dfplayer_queue_play_name(const char* name) {
+#if DFPLAYER_FILEMAP
+    // Mapped names go out as the much shorter AT+PLAYNUM
+    uint8_t file_number = filemap_lookup(name);
+    
+    if (file_number != 0) return dfplayer_queue_play_number(file_number);
+#endif
+    if (!dfplayer_queue_command(name, ARG_FILE_NAME)) return false;
+    paused = false;
+    return true;
+}
+
+// Emit AT+PLAYFILE=/<name>.mp3 from a packed base name
+static void dfplayer_send_play_name(const char* name) {
+    uint8_t i;
+    
+    dfplayer_send_string("AT+PLAYFILE=/");
+    for (i = 0; i < DFPLAYER_NAME_SIZE && name[i] != '\0'; i++) {
+        dfplayer_send_byte(name[i]);
+    }
+    dfplayer_send_string(".mp3\r\n");
+}
+
+uint16_t dfplayer_ack_timeout_count(void) {
+    return ack_timeouts;
+}
+
+void dfplayer_task(void) {
+#if DFPLAYER_STATUS_REFRESH_MS && DFPLAYER_BACKEND == DFPLAYER_BACKEND_PRO
+    static uint16_t refresh_at = 0;
     
-    // Read response
-    len = dfplayer_read_response(response, sizeof(response));
+    // Keep "what is playing" fresh without the application asking
+    if (scheduler_deadline_reached(refresh_at)) {
+        refresh_at = scheduler_millis() + DFPLAYER_STATUS_REFRESH_MS;
+        query_requested |= DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_CURRENT_FILE) |
+                           DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_ELAPSED_TIME) |
+                           DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_TIME);
+    }
+#endif
     
-    if (len > 0) {
-        // Parse simple response format: "15\r\n"
-        // Convert string to number
-        uint8_t file_count = 0;
-        char* ptr = response;
+    dfplayer_poll_responses();
+    
+    if (in_flight != EXPECT_NONE || !dfplayer_tx_idle()) return;
+    
+    // Queued commands first, then the volume slot, then status queries
+    if (cmd_count > 0) {
+        dfplayer_cmd_t* cmd = &cmd_queue[cmd_head];
         
-        // Skip any leading whitespace or non-digit characters
-        while (*ptr && (*ptr < '0' || *ptr > '9')) {
-            ptr++;
+        if (cmd->text == NULL) {
+            dfplayer_play_file_number(cmd->arg);
+        } else if (cmd->arg == ARG_FRAME) {
+            dfplayer_send_frame((const uint8_t*)cmd->text);
+        } else if (cmd->arg == ARG_FILE_NAME) {
+            dfplayer_send_play_name(cmd->text);
+        } else {
+            dfplayer_send_string(cmd->text);
+            if (cmd->arg != DFPLAYER_NO_ARG) {
+                dfplayer_send_number(cmd->arg);
+                dfplayer_send_string("\r\n");
+            }
         }
+        if (++cmd_head >= DFPLAYER_CMD_QUEUE_SIZE) cmd_head = 0;
+        cmd_count--;
+        dfplayer_expect(EXPECT_OK);
+    } else if (volume_target != volume_sent) {
+        // Volume goes out only when the level changed
+        volume_sent = volume_target;
+        dfplayer_set_volume(volume_sent);
+        dfplayer_expect(EXPECT_OK);
+    }
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_PRO
+    else if (query_requested) {
+        dfplayer_send_query();
+    }
+#endif
+}
+
+void dfplayer_query(dfplayer_query_t query) {
+    query_requested |= DFPLAYER_STATUS_BIT(query);
+}
+
+const dfplayer_status_t* dfplayer_status(void) {
+    return &status;
+}
+
+bool dfplayer_is_playing(void) {
+    if (paused) return false;  // A paused file keeps elapsed < total
+    if ((status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_ELAPSED_TIME)) == 0) return false;
+    if ((status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_TIME)) == 0) return false;
+    return status.elapsed_time < status.total_time;
+}
+
+void dfplayer_tx_isr(void) {
+    if (tx_tail != tx_head) {
+        TX1REG = tx_queue[tx_tail];
+        tx_tail = (tx_tail + 1) & TX_QUEUE_MASK;
+    }
+    if (tx_tail == tx_head) {
+        PIE1bits.TXIE = 0;  // Nothing left to send
+        scheduler_wake();   // Pipeline may send the next command
+    }
+}
+
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+void dfplayer_startup_sequence(void) {
+    static const uint8_t frame_volume[] = DFMINI_FRAME(DFMINI_CMD_VOLUME, DFPLAYER_VOLUME_DEFAULT);
+    static const uint8_t frame_startup[] = DFMINI_FRAME(DFMINI_CMD_PLAY_TRACK, 1);
+    
+    // No feedback line to probe - hold the pipeline while the Mini reads its
+    // SD card, then send the precomputed frames
+    in_flight = EXPECT_GAP;
+    ack_deadline = scheduler_millis() + DFPLAYER_MINI_BOOT_MS;
+    if (volume_target == DFPLAYER_VOLUME_DEFAULT) {
+        dfplayer_queue_frame(frame_volume);
+    } else {
+        volume_sent = DFPLAYER_NO_ARG;  // Stored level goes out through the volume slot
+    }
+    dfplayer_queue_frame(frame_startup);
+}
+#else
+// Wait for the next response line (boot only - blocks up to timeout_ms)
+static uint8_t dfplayer_wait_line(char* line, uint8_t max_len, uint16_t timeout_ms) {
+    uint16_t deadline = scheduler_millis() + timeout_ms;
+    uint8_t len;
+    
+    do {
+        len = dfplayer_read_response(line, max_len);
+    } while (len == 0 && !scheduler_deadline_reached(deadline));
+    return len;
+}
+
+// Send a command and wait for its OK, reading replies into the caller's
+// line buffer so the boot path keeps only one on the stack (boot only)
+static bool dfplayer_command_acked(const char* cmd, char* line, uint8_t max_len) {
+    dfplayer_send_string(cmd);
+    while (dfplayer_wait_line(line, max_len, DFPLAYER_ACK_TIMEOUT_MS)) {
+        if (line[0] == 'O' && line[1] == 'K') return true;
+    }
+    return false;
+}
+
+// Ask for a setting with "?" and return the answer line (boot only)
+static uint8_t dfplayer_ask(const char* cmd, char* line, uint8_t max_len) {
+    dfplayer_send_string(cmd);
+    return dfplayer_wait_line(line, max_len, DFPLAYER_ACK_TIMEOUT_MS);
+}
+
+#if DFPLAYER_FILEMAP
+// Refresh the file name map if the SD card changed (boot only)
+// A rebuild plays every file muted for a moment and reads its name back
+static void dfplayer_scan_files(char* line, uint8_t max_len) {
+    uint16_t deadline;
+    uint8_t count;
+    uint8_t n;
+    
+    if ((status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_FILES)) == 0) return;
+    if (filemap_load(status.total_files)) return;
+    
+    count = filemap_scan_count(status.total_files);
+    dfplayer_command_acked("AT+VOL=0\r\n", line, max_len);
+    filemap_begin();
+    for (n = 1; n <= count; n++) {
+        dfplayer_send_string("AT+PLAYNUM=");
+        dfplayer_send_number(n);
+        dfplayer_command_acked("\r\n", line, max_len);
         
-        // Extract number
-        while (*ptr >= '0' && *ptr <= '9') {
-            file_count = file_count * 10 + (*ptr - '0');
-            ptr++;
+        dfplayer_send_string("AT+QUERY=5\r\n");
+        deadline = scheduler_millis() + DFPLAYER_ACK_TIMEOUT_MS;
+        while (dfplayer_read_filename(line, max_len) == 0) {
+            if (scheduler_deadline_reached(deadline)) {
+                line[0] = '\0';  // No answer - leave this file unmapped
+                break;
+            }
         }
-        
-        return file_count;
+        filemap_store(line);
+    }
+    filemap_commit(status.total_files);
+    
+    // Pause the last file before the volume comes back up
+    if (count > 0) dfplayer_command_acked("AT+PLAY=PP\r\n", line, max_len);
+}
+#endif
+
+void dfplayer_startup_sequence(void) {
+    char line[DFPLAYER_RX_LINE_SIZE];
+    uint16_t give_up_at = scheduler_millis() + DFPLAYER_STARTUP_TIMEOUT;
+    
+    // Probe until the DFPlayer answers instead of waiting a fixed worst case
+    while (!scheduler_deadline_reached(give_up_at)) {
+        dfplayer_send_string("AT\r\n");
+        if (dfplayer_wait_line(line, sizeof(line), DFPLAYER_PROBE_INTERVAL_MS) &&
+            line[0] == 'O' && line[1] == 'K') {
+            break;
+        }
+    }
+    
+    // A slow first answer leaves OKs for later probes in flight - drain them
+    // until the line stays quiet, or each reply below would be one behind
+    while (dfplayer_wait_line(line, sizeof(line), DFPLAYER_PROBE_INTERVAL_MS));
+    
+    // File count, to check the card against the generated playlist tables
+    if (dfplayer_ask("AT+QUERY=2\r\n", line, sizeof(line))) {
+        status.total_files = dfplayer_parse_number(line);
+        status.valid |= DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_FILES);
+    }
+    
+    // LED and PLAYMODE survive power-down - only write them if they differ
+    if (!dfplayer_ask("AT+LED=?\r\n", line, sizeof(line)) || strstr(line, "OFF") == NULL) {
+        dfplayer_command_acked("AT+LED=OFF\r\n", line, sizeof(line));     // Turn off LED indicator
+    }
+    
+#if DFPLAYER_FILEMAP
+    dfplayer_scan_files(line, sizeof(line));
+#endif
+    
+    // Volume is not kept across power-down - restore the requested level
+    volume_sent = volume_target;
+    dfplayer_send_string("AT+VOL=");
+    dfplayer_send_number(volume_sent);
+    dfplayer_command_acked("\r\n", line, sizeof(line));
+    
+    // Set to play one song and pause
+    if (!dfplayer_ask("AT+PLAYMODE=?\r\n", line, sizeof(line)) || dfplayer_parse_number(line) != 3) {
+        dfplayer_command_acked("AT+PLAYMODE=3\r\n", line, sizeof(line));
+    }
+    
+    // Drop any trailing OK from the queries before the async layer takes over
+    dfplayer_read_response(line, sizeof(line));
+    
+    // Play the startup file through the pipeline - no need to wait for it
+    dfplayer_queue_play_number(1);
+}
+#endif
+
+uint8_t dfplayer_get_total_files(void) {
+    if ((status.valid & DFPLAYER_STATUS_BIT(DFPLAYER_QUERY_TOTAL_FILES)) == 0) {
+        dfplayer_query(DFPLAYER_QUERY_TOTAL_FILES);
+        return 0; // Not answered yet
     }
     
-    return 0; // Could not determine file count
+    return (status.total_files > 255) ? 255 : (uint8_t)status.total_files;
 }
 
 void dfplayer_query_current_file(void) {
-    dfplayer_send_string("AT+QUERY=1\r\n");
+    dfplayer_query(DFPLAYER_QUERY_CURRENT_FILE);
 }
 
 void dfplayer_play_file_number(uint8_t file_number) {
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+    dfplayer_send_mini(DFMINI_CMD_PLAY_TRACK, file_number);
+#else
     dfplayer_send_string("AT+PLAYNUM=");
     dfplayer_send_number(file_number);
     dfplayer_send_string("\r\n");
+#endif
 }
 
 void dfplayer_set_volume(uint8_t volume) {
     if (volume > 30) volume = 30;  // Clamp to maximum volume
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI
+    dfplayer_send_mini(DFMINI_CMD_VOLUME, volume);
+#else
     dfplayer_send_string("AT+VOL=");
     dfplayer_send_number(volume);
     dfplayer_send_string("\r\n");
+#endif
 }
@@ -1,6 +1,6 @@
 /**
  * @file dfplayer.h  
- * @brief DFPlayer Mini audio module control
+ * @brief DFPlayer Pro / DFPlayer Mini audio module control
  *
  * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
  * @license MIT License - see LICENSE file for details
@@ -11,63 +11,244 @@
 
 #include "config.h"
 
+/**
+ * @brief Asynchronous status queries (value is the AT+QUERY= parameter)
+ */
+typedef enum {
+    DFPLAYER_QUERY_CURRENT_FILE = 1,
+    DFPLAYER_QUERY_TOTAL_FILES = 2,
+    DFPLAYER_QUERY_ELAPSED_TIME = 3,
+    DFPLAYER_QUERY_TOTAL_TIME = 4,
+    DFPLAYER_QUERY_FILE_NAME = 5
+} dfplayer_query_t;
+
+#define DFPLAYER_STATUS_BIT(query) (1u << (query))
+
+#define DFPLAYER_NO_ARG 0xFF  // dfplayer_queue_command() without a number
+
+#define DFPLAYER_NAME_SIZE 8  // Packed file name: 8.3 base name, NUL padded
+
+#if DFPLAYER_BACKEND == DFPLAYER_BACKEND_MINI && PLAYLIST_PLAY_BY_NAME
+#error "The DFPlayer Mini backend plays by file number only"
+#endif
+
+/**
+ * @brief DFPlayer Mini binary frame: 7E FF 06 cmd 00 param_hi param_lo chk_hi chk_lo EF
+ *
+ * The checksum is the 16-bit negated sum of bytes 1-6. With constant arguments
+ * DFMINI_FRAME() folds to a const initializer, so the frame and its checksum
+ * are computed at compile time and stored in ROM.
+ */
+#define DFMINI_FRAME_SIZE 10
+#define DFMINI_CMD_NEXT 0x01
+#define DFMINI_CMD_PLAY_TRACK 0x03
+#define DFMINI_CMD_VOLUME 0x06
+#define DFMINI_CMD_STOP 0x16
+#define DFMINI_CHECKSUM(cmd, param) \
+    ((uint16_t)(0u - (0xFFu + 0x06u + (cmd) + ((param) >> 8) + ((param) & 0xFFu))))
+#define DFMINI_FRAME(cmd, param) { \
+    0x7E, 0xFF, 0x06, (cmd), 0x00, \
+    (uint8_t)((param) >> 8), (uint8_t)(param), \
+    (uint8_t)(DFMINI_CHECKSUM(cmd, param) >> 8), (uint8_t)DFMINI_CHECKSUM(cmd, param), \
+    0xEF }
+
+/**
+ * @brief Cached query results, updated in the background by dfplayer_task()
+ */
+typedef struct {
+    uint16_t current_file;   // File number of the currently-playing file
+    uint16_t total_files;    // Total number of files on the SD card
+    uint16_t elapsed_time;   // Seconds played of the current file
+    uint16_t total_time;     // Length of the current file in seconds
+#if DFPLAYER_FILE_NAME_SIZE
+    char file_name[DFPLAYER_FILE_NAME_SIZE];  // Answer to DFPLAYER_QUERY_FILE_NAME
+#endif
+    uint8_t valid;           // DFPLAYER_STATUS_BIT() set for each answered query
+} dfplayer_status_t;
+
 /**
  * @brief Initialize DFPlayer module
  */
 void dfplayer_init(void);
 
 /**
- * @brief Send a string command to DFPlayer
+ * @brief Queue a string command for DFPlayer
  * @param str Command string to send
+ * @note Returns as soon as the string is queued; waits only if the TX queue is full
  */
 void dfplayer_send_string(const char* str);
 
 /**
- * @brief Send a single byte to DFPlayer
+ * @brief Queue a single byte for DFPlayer
  * @param byte Byte to send
+ * @note Returns as soon as the byte is queued; waits only if the TX queue is full
  */
 void dfplayer_send_byte(char byte);
 
 /**
- * @brief Play startup sound and configure DFPlayer
+ * @brief Get free space in the TX queue
+ * @return Number of bytes that can be queued without waiting
+ */
+uint8_t dfplayer_tx_free(void);
+
+/**
+ * @brief Check whether all queued bytes have been handed to the EUSART
+ * @return true if the TX queue is empty
+ */
+bool dfplayer_tx_idle(void);
+
+/**
+ * @brief Request a volume level, coalesced with any request not yet sent
+ * @param volume Volume level (0-30)
+ * @note Only the newest request is kept; it is sent by dfplayer_task() once
+ *       the pipeline is free, and only if it differs from the last level sent
+ */
+void dfplayer_request_volume(uint8_t volume);
+
+/**
+ * @brief Run the command pipeline: match responses to the command in flight and
+ *        send the next queued command, volume update or query once it is answered
+ */
+void dfplayer_task(void);
+
+/**
+ * @brief Queue a command for the acknowledgement-paced pipeline
+ * @param text Full command line ending in "\r\n", or a prefix such as
+ *             "AT+PLAYNUM=" when arg is used (must stay valid until sent)
+ * @param arg Number appended to text followed by "\r\n", or DFPLAYER_NO_ARG
+ * @return false if the command queue is full
+ * @note Sent by dfplayer_task() as soon as the previous command is acknowledged
+ */
+bool dfplayer_queue_command(const char* text, uint8_t arg);
+
+/**
+ * @brief Queue playback of a file number for the command pipeline
+ * @param file_number File number to play (1-based, SD card order)
+ * @return false if the command queue is full
+ * @note Sent as AT+PLAYNUM=n (Pro) or a play-track frame (Mini)
+ */
+bool dfplayer_queue_play_number(uint8_t file_number);
+
+/**
+ * @brief Queue a skip to the next file
+ * @return false if the command queue is full
+ */
+bool dfplayer_queue_next(void);
+
+/**
+ * @brief Queue a stop of the current playback
+ * @return false if the command queue is full
+ * @note The DFPlayer Pro has no stop command; AT+PLAY=PP toggles pause instead,
+ *       so it is sent once per started file and skipped when the status cache
+ *       shows the file finished. That check needs DFPLAYER_STATUS_REFRESH_MS;
+ *       without it a stop after a file ended on its own may restart it
+ */
+bool dfplayer_queue_stop(void);
+
+/**
+ * @brief Queue a precomputed DFPlayer Mini frame (see DFMINI_FRAME)
+ * @param frame DFMINI_FRAME_SIZE bytes, typically a const ROM array
+ * @return false if the command queue is full
+ */
+bool dfplayer_queue_frame(const uint8_t* frame);
+
+/**
+ * @brief Queue AT+PLAYFILE=/<name>.mp3 for the acknowledgement-paced pipeline
+ * @param name Packed DFPLAYER_NAME_SIZE-byte base name (NUL padded, not
+ *             necessarily terminated), typically a row of a const ROM table
+ * @return false if the command queue is full
+ * @note The "AT+PLAYFILE=/" prefix and ".mp3\r\n" suffix are emitted by the
+ *       send path, so tables only store the base names
+ */
+bool dfplayer_queue_play_name(const char* name);
+
+/**
+ * @brief Get how many commands were given up on without an acknowledgement
+ * @return Number of acknowledgement timeouts since boot
+ */
+uint16_t dfplayer_ack_timeout_count(void);
+
+/**
+ * @brief Feed the next queued byte to the EUSART (call from ISR on TXIF)
+ */
+void dfplayer_tx_isr(void);
+
+/**
+ * @brief Probe for the DFPlayer, configure it and play the startup sound
+ * @note Returns as soon as the DFPlayer has acknowledged its configuration;
+ *       settings it already keeps across power-down are not rewritten
  */
 void dfplayer_startup_sequence(void);
 
 /**
- * @brief Get total number of files (sends query and reads response)
- * @return Number of files on SD card, or 0 if unable to read
+ * @brief Get total number of files from the status cache
+ * @return Number of files on SD card, or 0 if not known yet
+ * @note Requests a refresh if the count has not been answered yet
  */
 uint8_t dfplayer_get_total_files(void);
 
 /**
- * @brief Read response from DFPlayer via software UART on RA2
- * @param buffer Buffer to store response
+ * @brief Request a status query (non-blocking)
+ * @param query Query to send; repeated requests before it is sent coalesce
+ * @note The answer lands in the cache returned by dfplayer_status(); a file
+ *       name is only kept with DFPLAYER_FILE_NAME_SIZE set
+ */
+void dfplayer_query(dfplayer_query_t query);
+
+/**
+ * @brief Get the cached query results
+ * @return Pointer to the status cache (read-only)
+ */
+const dfplayer_status_t* dfplayer_status(void);
+
+/**
+ * @brief Check from the cache whether a file is playing
+ * @return true if the last answered elapsed time is below the file length
+ *         and no stop was queued since the file started
+ * @note Needs DFPLAYER_STATUS_REFRESH_MS; with it off this is always false
+ */
+bool dfplayer_is_playing(void);
+
+/**
+ * @brief Take a completed response line received on RA2 (non-blocking)
+ * @param buffer Buffer to store response, including the trailing "\r\n"
  * @param max_len Maximum buffer length
- * @return Number of bytes read
+ * @return Number of bytes read, or 0 if no complete line is waiting
  */
 uint8_t dfplayer_read_response(char* buffer, uint8_t max_len);
 
 /**
- * @brief Read filename response from DFPlayer, filtering null bytes
+ * @brief Take a completed filename response (non-blocking)
  * @param buffer Buffer to store filename
  * @param max_len Maximum buffer length
- * @return Number of bytes read
+ * @return Number of bytes read, or 0 if no complete line is waiting
+ * @note Null bytes are dropped by the receiver before they reach the line
  */
 uint8_t dfplayer_read_filename(char* buffer, uint8_t max_len);
 
 /**
- * @brief Query current playing file number
+ * @brief Start-bit edge on RA2 (call from ISR on IOCAF2)
+ */
+void dfplayer_rx_edge_isr(void);
+
+/**
+ * @brief Sample the next RA2 data bit (call from ISR on TMR2IF)
+ */
+void dfplayer_rx_bit_isr(void);
+
+/**
+ * @brief Request the current playing file number (answer lands in the cache)
  */
 void dfplayer_query_current_file(void);
 
 /**
- * @brief Play specific file by number
+ * @brief Play specific file by number (sent immediately, bypassing the pipeline)
  * @param file_number File number to play (1-based)
  */
 void dfplayer_play_file_number(uint8_t file_number);
 
 /**
- * @brief Set DFPlayer volume
+ * @brief Set DFPlayer volume (sent immediately, bypassing the pipeline)
  * @param volume Volume level (0-30)
  */
 void dfplayer_set_volume(uint8_t volume);
@@ -0,0 +1,137 @@
+/**
+ * @file filemap.c
+ * @brief SD card file name to file number map, kept in data EEPROM implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "filemap.h"
+#include "dfplayer.h"
+#include "nvm.h"
+
+#if FILEMAP_ENABLE
+
+// Layout: file count, CRC-8 of count and entries, then one big-endian
+// 16-bit name hash per file number starting at file 1
+#define MAP_COUNT 0
+#define MAP_CRC 1
+#define MAP_ENTRY(n) (2 + ((n) - 1) * 2)
+#define MAP_CAPACITY ((FILEMAP_EEPROM_SIZE - 2) / 2)
+
+#define HASH_NONE 0xFFFF  // File that did not report a name (erased EEPROM reads the same)
+
+#if FILEMAP_EEPROM_BASE < SETTINGS_EEPROM_BASE + SETTINGS_EEPROM_SIZE && \
+    SETTINGS_EEPROM_BASE < FILEMAP_EEPROM_BASE + FILEMAP_EEPROM_SIZE
+#error "FILEMAP_EEPROM region overlaps the settings ring"
+#endif
+
+static uint8_t entries = 0;      // Mapped files; 0 disables lookups
+static uint8_t build_count = 0;  // Files stored so far by a rebuild
+static uint8_t build_crc = 0;
+
+// Hash the base name: skip any directory, stop at the extension, ignore case
+static uint16_t filemap_hash(const char* name, uint8_t max_len) {
+    const char* base = name;
+    uint16_t hash = 0;
+    uint8_t i;
+    
+    for (i = 0; i < max_len && name[i] != '\0'; i++) {
+        if (name[i] == '/') base = &name[i + 1];
+    }
+    max_len -= (uint8_t)(base - name);
+    
+    for (i = 0; i < max_len; i++) {
+        char c = base[i];
+        
+        if (c == '\0' || c == '.' || c == '\r' || c == '\n') break;
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        hash = (uint16_t)((hash << 5) | (hash >> 11)) ^ (uint8_t)c;  // Rotate left 5, mix
+    }
+    return (hash == HASH_NONE) ? HASH_NONE - 1 : hash;
+}
+
+// Write a byte and wait for it, skipping bytes that already match (boot only)
+static void filemap_write(uint8_t offset, uint8_t data) {
+    uint8_t address = FILEMAP_EEPROM_BASE + offset;
+    
+    if (nvm_eeprom_read(address) == data) return;
+    nvm_eeprom_write(address, data);
+    while (nvm_eeprom_busy());
+}
+
+uint8_t filemap_scan_count(uint16_t total_files) {
+    return (total_files > MAP_CAPACITY) ? MAP_CAPACITY : (uint8_t)total_files;
+}
+
+bool filemap_load(uint16_t total_files) {
+    uint8_t count = filemap_scan_count(total_files);
+    uint8_t crc = 0;
+    uint8_t i;
+    
+    entries = 0;
+    for (i = MAP_ENTRY(1); i < MAP_ENTRY(count + 1); i++) {
+        crc = nvm_crc8(crc, nvm_eeprom_read(FILEMAP_EEPROM_BASE + i));
+    }
+    
+    // A different count means files were added or removed - rebuild
+    if (nvm_eeprom_read(FILEMAP_EEPROM_BASE + MAP_COUNT) != count) return false;
+    if (nvm_eeprom_read(FILEMAP_EEPROM_BASE + MAP_CRC) != nvm_crc8(crc, count)) return false;
+    
+    entries = count;
+    return true;
+}
+
+void filemap_begin(void) {
+    entries = 0;
+    build_count = 0;
+    build_crc = 0;
+}
+
+void filemap_store(const char* name) {
+    uint16_t hash = HASH_NONE;
+    
+    if (build_count >= MAP_CAPACITY) return;
+    build_count++;
+    
+    if (name[0] != '\0') hash = filemap_hash(name, DFPLAYER_RX_LINE_SIZE);
+    filemap_write(MAP_ENTRY(build_count), hash >> 8);
+    filemap_write(MAP_ENTRY(build_count) + 1, hash & 0xFF);
+    build_crc = nvm_crc8(build_crc, hash >> 8);
+    build_crc = nvm_crc8(build_crc, hash & 0xFF);
+}
+
+void filemap_commit(uint16_t total_files) {
+    // Files the scan did not reach are left unmapped
+    while (build_count < filemap_scan_count(total_files)) {
+        filemap_store("");
+    }
+    
+    // CRC goes last so a rebuild cut short by power loss is redone next boot
+    filemap_write(MAP_COUNT, build_count);
+    filemap_write(MAP_CRC, nvm_crc8(build_crc, build_count));
+    entries = build_count;
+}
+
+uint8_t filemap_lookup(const char* name) {
+    uint16_t hash;
+    uint8_t address = FILEMAP_EEPROM_BASE + MAP_ENTRY(1);
+    uint8_t found = 0;
+    uint8_t n;
+    
+    // A settings save in progress owns the EEPROM - let the DFPlayer resolve the name
+    if (entries == 0 || nvm_eeprom_busy()) return 0;
+    
+    hash = filemap_hash(name, DFPLAYER_NAME_SIZE);
+    for (n = 1; n <= entries; n++, address += 2) {
+        if (nvm_eeprom_read(address) != (hash >> 8)) continue;
+        if (nvm_eeprom_read(address + 1) != (hash & 0xFF)) continue;
+        
+        // Two files with the same hash - let the DFPlayer resolve the name
+        if (found != 0) return 0;
+        found = n;
+    }
+    return found;
+}
+
+#endif // FILEMAP_ENABLE
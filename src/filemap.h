@@ -0,0 +1,60 @@
+/**
+ * @file filemap.h
+ * @brief SD card file name to file number map, kept in data EEPROM
+ *
+ * The DFPlayer Pro startup scan plays each file muted, reads its name back
+ * with AT+QUERY=5 and stores a 16-bit hash of the name per file number.
+ * Play-by-name triggers then go out as a short AT+PLAYNUM=n instead of
+ * AT+PLAYFILE=/<name>.mp3. The map is rebuilt only when the file count
+ * reported by AT+QUERY=2 changes.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include "config.h"
+
+/**
+ * @brief Check the stored map against the SD card and enable lookups if it fits
+ * @param total_files File count reported by the DFPlayer
+ * @return true if the map is intact and was built for this file count
+ */
+bool filemap_load(uint16_t total_files);
+
+/**
+ * @brief Number of files a rebuild will scan
+ * @param total_files File count reported by the DFPlayer
+ * @return total_files, capped at the map capacity
+ */
+uint8_t filemap_scan_count(uint16_t total_files);
+
+/**
+ * @brief Start a rebuild; lookups are disabled until filemap_commit()
+ */
+void filemap_begin(void);
+
+/**
+ * @brief Record the name of the next file number (call for 1, 2, 3, ...)
+ * @param name Name as read back from the DFPlayer, "" if it did not answer
+ * @note Blocks for each EEPROM byte that changes (boot only)
+ */
+void filemap_store(const char* name);
+
+/**
+ * @brief Finish a rebuild by writing the header and CRC, then enable lookups
+ * @param total_files File count the map was built for
+ */
+void filemap_commit(uint16_t total_files);
+
+/**
+ * @brief Find the file number of a packed base name
+ * @param name Packed DFPLAYER_NAME_SIZE base name (as in playlists.h)
+ * @return File number, or 0 if the name is not mapped, its hash is ambiguous
+ *         or the EEPROM is busy with a settings write
+ */
+uint8_t filemap_lookup(const char* name);
+
+#endif // FILEMAP_H
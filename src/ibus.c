@@ -8,125 +8,330 @@
 
 #include "ibus.h"
 #include "dfplayer.h"
+#include "scheduler.h"
+#include "actions.h"
 #include "../mcc_generated_files/system/system.h"
-#include "../mcc_generated_files/timer/delay.h"
 
 // i-Bus packet structure constants
 #define IBUS_HEADER1 0x20
 #define IBUS_HEADER2 0x40
 #define IBUS_CHANNEL_COUNT 14
+#define IBUS_CHECKSUM_OFFSET 30
+
+// Decoder position used while discarding bytes until the next idle gap
+#define IBUS_POS_WAIT_GAP 0xFF
+
+#if IBUS_GAP_FRAMING
+#define IBUS_POS_RESYNC IBUS_POS_WAIT_GAP
+#else
+#define IBUS_POS_RESYNC 0
+#endif
 
 // Switch states for channel 5
 #define SWITCH_UP_VALUE 1000
 #define SWITCH_DOWN_VALUE 2000
 
-// Ring buffer for UART RX data
-#define RING_BUFFER_SIZE 64
-static volatile uint8_t ring_buffer[RING_BUFFER_SIZE];
-static volatile uint8_t buffer_head = 0;
-static volatile uint8_t buffer_tail = 0;
+// Below three frame periods a single late frame would trip failsafe
+#if IBUS_FAILSAFE_TIMEOUT_MS < 21
+#error "IBUS_FAILSAFE_TIMEOUT_MS must be at least 21 (three frame periods)"
+#endif
+
+// Channels decoded from the 14 16-bit slots; 15-18 need all of them
+#if IBUS_CHANNELS > IBUS_CHANNEL_COUNT
+#define IBUS_SLOTS_USED IBUS_CHANNEL_COUNT
+#else
+#define IBUS_SLOTS_USED IBUS_CHANNELS
+#endif
+
+// Double-buffered frame storage
+// The ISR assembles the channel data it needs (from byte 2) straight into the
+// fill buffer and publishes a completed frame by swapping pointers and bumping
+// frame_seq. A published buffer is only reused after the next frame is
+// published, so a reader that sees frame_seq unchanged got a consistent value.
+#define IBUS_FRAME_DATA_SIZE (IBUS_SLOTS_USED * 2)
+static uint8_t frame_buffer_a[IBUS_FRAME_DATA_SIZE];
+static uint8_t frame_buffer_b[IBUS_FRAME_DATA_SIZE];
+static uint8_t * volatile frame_ready = frame_buffer_a;  // Last published frame
+static uint8_t *frame_fill = frame_buffer_b;             // Being assembled (ISR only)
+static volatile uint8_t frame_seq = 0;                   // Bumped on each publish
+
+// Sequence number of the last frame handed to process_ibus_input()
+// Only the newest frame is ever decoded; frames published in between are
+// superseded and counted, so a stall never leaves a backlog to work through
+static uint8_t frame_seq_consumed = 0;
 
-// i-Bus packet storage
-static uint8_t ibus_packet[IBUS_PACKET_SIZE];
+// Link statistics (ISR writes all but skipped_frames and failsafes,
+// ibus_get_stats() snapshots)
+#if IBUS_STATS
+static ibus_stats_t ibus_stats = { .interval_min = 0xFFFF };
+#define IBUS_STAT_ADD(field, n) (ibus_stats.field += (n))
+#else
+#define IBUS_STAT_ADD(field, n)
+#endif
 
-// Ring buffer helper functions
-static uint8_t ring_buffer_available(void) {
-    return (buffer_head != buffer_tail);
+// Decoder position within the current frame (ISR only)
+static uint8_t packet_pos = IBUS_POS_RESYNC;
+
+// Channel values decoded once per frame, and which of them changed
+static uint16_t channels[IBUS_CHANNELS];
+static ibus_mask_t channels_changed = 0;
+
+// Failsafe: set at boot and when frames stop; cleared by the next valid frame
+static const uint16_t failsafe_values[] = IBUS_FAILSAFE_VALUES;
+static bool failsafe = true;
+
+#if IBUS_GAP_FRAMING || IBUS_STATS
+// Read free-running Timer1 (1 tick per us), guarding against a low byte rollover
+static uint16_t ibus_timestamp(void) {
+    uint8_t high = TMR1H;
+    uint8_t low = TMR1L;
+
+    if (TMR1H != high) {
+        high = TMR1H;
+        low = TMR1L;
+    }
+    return ((uint16_t)high << 8) | low;
 }
+#endif
 
-static uint8_t ring_buffer_read(void) {
-    uint8_t data;
-    if (buffer_head != buffer_tail) {
-        data = ring_buffer[buffer_tail];
-        buffer_tail = (buffer_tail + 1) % RING_BUFFER_SIZE;
-        return data;
+#if IBUS_STATS
+// Frame interval tracking (ISR only). Timer1 wraps every 65.5ms; wraps are
+// counted (saturating at 2) so an interval spanning a longer outage is dropped
+// instead of aliasing into a short one.
+static uint16_t last_frame_time = 0;
+static uint8_t timer1_wraps = 2;  // No reference frame yet
+
+// Account for a published frame in the statistics
+static void ibus_frame_stats(void) {
+    uint16_t now = ibus_timestamp();
+    uint16_t interval = now - last_frame_time;
+    
+    ibus_stats.valid_frames++;
+    
+    if (timer1_wraps == 0 || (timer1_wraps == 1 && now < last_frame_time)) {
+        if (interval < ibus_stats.interval_min) ibus_stats.interval_min = interval;
+        if (interval > ibus_stats.interval_max) ibus_stats.interval_max = interval;
+        
+        // Exponential moving average, weight 1/8 (seeded by the first interval);
+        // clamped so the difference always fits an int16_t
+        if (interval > 0x7FFF) interval = 0x7FFF;
+        if (ibus_stats.interval_avg == 0) {
+            ibus_stats.interval_avg = interval;
+        } else {
+            ibus_stats.interval_avg += (int16_t)(interval - ibus_stats.interval_avg) >> 3;
+        }
     }
-    return 0; // Should not happen if ring_buffer_available() is checked first
+    last_frame_time = now;
+    timer1_wraps = 0;
 }
+#endif
+
+// Single-pass i-Bus frame decoder, called from the ISR for every byte
+// The checksum (0xFFFF minus the sum of bytes 0-29) is built up as each byte
+// arrives, so a frame is accepted or rejected on its last byte without any
+// second pass over the buffer.
+static void ibus_receive_byte(uint8_t byte_val) {
+    static uint16_t checksum = 0;
+
+#if IBUS_GAP_FRAMING
+    static uint16_t last_rx_time = 0;
+    uint16_t now = ibus_timestamp();
+
+    // An idle gap always marks the start of a new frame
+    if ((uint16_t)(now - last_rx_time) > IBUS_FRAME_GAP_US) {
+        packet_pos = 0;
+    }
+    last_rx_time = now;
 
-// UART RX Interrupt Service Routine
+    if (packet_pos == IBUS_POS_WAIT_GAP) return;
+#endif
+
+    if (packet_pos == 0) {
+        // First header byte
+        if (byte_val != IBUS_HEADER1) {
+            packet_pos = IBUS_POS_RESYNC;
+#if IBUS_GAP_FRAMING
+            IBUS_STAT_ADD(resyncs, 1);  // Frame after a gap did not start with a header
+#endif
+            return;
+        }
+        checksum = 0xFFFF - IBUS_HEADER1;
+    } else if (packet_pos == 1) {
+        // Second header byte, or restart the hunt
+        if (byte_val != IBUS_HEADER2) {
+            IBUS_STAT_ADD(resyncs, 1);
+#if IBUS_GAP_FRAMING
+            packet_pos = IBUS_POS_WAIT_GAP;
+#else
+            packet_pos = (byte_val == IBUS_HEADER1) ? 1 : 0;
+#endif
+            return;
+        }
+        checksum -= IBUS_HEADER2;
+    } else if (packet_pos < IBUS_CHECKSUM_OFFSET) {
+        // Channel data - store what is decoded and accumulate checksum
+        if (packet_pos < IBUS_FRAME_DATA_SIZE + 2) {
+            frame_fill[packet_pos - 2] = byte_val;
+        }
+        checksum -= byte_val;
+    } else if (packet_pos == IBUS_CHECKSUM_OFFSET) {
+        // Checksum low byte
+        if (byte_val != (uint8_t)checksum) {
+            packet_pos = IBUS_POS_RESYNC;
+            IBUS_STAT_ADD(checksum_errors, 1);
+            return;
+        }
+    } else {
+        // Checksum high byte completes the frame
+        packet_pos = IBUS_POS_RESYNC;
+        if (byte_val == (uint8_t)(checksum >> 8)) {
+            // Publish: swap buffers and advance the sequence number
+            uint8_t *completed = frame_fill;
+            frame_fill = frame_ready;
+            frame_ready = completed;
+            frame_seq++;
+            scheduler_wake();  // Process the frame now, not on the next tick
+#if IBUS_STATS
+            ibus_frame_stats();
+#endif
+        } else {
+            IBUS_STAT_ADD(checksum_errors, 1);
+        }
+        return;
+    }
+
+    packet_pos++;
+}
+
+// Interrupt Service Routine (UART RX/TX, DFPlayer software RX, scheduler tick)
 void __interrupt() ISR(void) {
+#if IBUS_STATS
+    // Timer1 wrap bookkeeping for frame intervals (polled - at least every 1ms tick)
+    if (PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        if (timer1_wraps < 2) timer1_wraps++;
+    }
+#endif
+    
     // Handle UART RX interrupt
     if (PIE1bits.RCIE && PIR1bits.RCIF) {
-        // Read the received byte
-        uint8_t received_byte = RCREG1;
-        
-        // Store in ring buffer
-        uint8_t next_head = (buffer_head + 1) % RING_BUFFER_SIZE;
-        if (next_head != buffer_tail) {
-            // Buffer not full, store the byte
-            ring_buffer[buffer_head] = received_byte;
-            buffer_head = next_head;
+        if (RC1STAbits.OERR) {
+            // Overrun stops the receiver until CREN is toggled
+            RC1STAbits.CREN = 0;
+            RC1STAbits.CREN = 1;
+            IBUS_STAT_ADD(overruns, 1);
+            packet_pos = IBUS_POS_RESYNC;  // Bytes were lost - drop this frame
+        } else if (RC1STAbits.FERR) {
+            // FERR belongs to the byte at the top of the FIFO - read to discard
+            (void)RCREG1;
+            IBUS_STAT_ADD(framing_errors, 1);
+            packet_pos = IBUS_POS_RESYNC;
+        } else {
+            // Reading RCREG1 clears RCIF
+            ibus_receive_byte(RCREG1);
         }
-        // If buffer full, just discard byte
-        
-        // Clear the interrupt flag
-        PIR1bits.RCIF = 0;
+    }
+    
+    // Sample DFPlayer response bits on RA2 (bit timing is critical)
+    if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+        dfplayer_rx_bit_isr();
+    }
+    
+    // Start bit on RA2
+    if (PIE0bits.IOCIE && IOCAFbits.IOCAF2) {
+        dfplayer_rx_edge_isr();
+    }
+    
+    // Handle UART TX interrupt (DFPlayer command queue)
+    if (PIE1bits.TXIE && PIR1bits.TXIF) {
+        dfplayer_tx_isr();
+    }
+    
+    // Handle Timer0 1ms scheduler tick
+    if (PIE0bits.TMR0IE && PIR0bits.TMR0IF) {
+        scheduler_tick_isr();
     }
 }
 
-// Ultra-simple i-Bus packet reading - just find header and read 32 bytes
+// Decode a newly published frame into channels[] and build the change mask
+// Returns 1 when a new frame was decoded since the last call
 static uint8_t read_ibus_packet(void) {
-    static uint8_t looking_for_header = 1;
-    static uint8_t packet_pos = 0;
-    uint8_t byte_val;
+    uint16_t decoded[IBUS_CHANNELS];
+    uint8_t seq = frame_seq;
+    const uint8_t *frame;
+    const uint8_t *data;
+    ibus_mask_t bit;
+    ibus_mask_t changed;
+    uint8_t i;
 
-    // Data arrives via interrupts, no need to poll
-    
-    // Process bytes one at a time from ring buffer
-    while (ring_buffer_available() > 0) {
-        byte_val = ring_buffer_read();
-        
-        if (looking_for_header) {
-            // Look for 0x20 0x40 sequence
-            if (packet_pos == 0 && byte_val == IBUS_HEADER1) {
-                ibus_packet[0] = byte_val;
-                packet_pos = 1;
-            } else if (packet_pos == 1 && byte_val == IBUS_HEADER2) {
-                ibus_packet[1] = byte_val;
-                packet_pos = 2;
-                looking_for_header = 0; // Now read the rest
-            } else {
-                // Reset if we don't get the right sequence
-                packet_pos = 0;
-                if (byte_val == IBUS_HEADER1) {
-                    ibus_packet[0] = byte_val;
-                    packet_pos = 1;
-                }
-            }
-        } else {
-            // Reading packet data
-            ibus_packet[packet_pos] = byte_val;
-            packet_pos++;
-            
-            if (packet_pos >= IBUS_PACKET_SIZE) {
-                // Got full packet - validate it doesn't have embedded headers
-                uint8_t valid = 1;
-                uint8_t i;
-                
-                // Check for any embedded 0x20 0x40 sequences in positions 2-30
-                for (i = 2; i < IBUS_PACKET_SIZE - 1; i++) {
-                    if (ibus_packet[i] == 0x20 && ibus_packet[i+1] == 0x40) {
-                        valid = 0;
-                        break;
-                    }
-                }
-                
-                looking_for_header = 1;
-                packet_pos = 0;
-                
-                if (valid) {
-                    return 1; // Return only clean packets
-                }
-                // If invalid, continue looking for next packet
-            }
+    if (seq == frame_seq_consumed) return 0;
+
+    // Decode into locals and retry if the ISR published again meanwhile, so
+    // a torn read never reaches channels[] or the change mask
+    do {
+        seq = frame_seq;
+        frame = frame_ready;
+        data = frame;
+
+        for (i = 0; i < IBUS_SLOTS_USED; i++) {
+            // Low byte first in i-Bus
+            decoded[i] = (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+#if IBUS_CHANNELS > IBUS_CHANNEL_COUNT
+            decoded[i] &= 0x0FFF;  // High nibble carries channels 15-18
+#endif
+            data += 2;
         }
+
+#if IBUS_CHANNELS > IBUS_CHANNEL_COUNT
+        // Channels 15-18 are spread over the high nibbles of three
+        // consecutive channel high bytes each (ch1-3, ch4-6, ...)
+        data = frame + 1;
+        for (; i < IBUS_CHANNELS; i++) {
+            decoded[i] = (data[0] >> 4) | (data[2] & 0xF0) | ((uint16_t)(data[4] & 0xF0) << 4);
+            data += 6;
+        }
+#endif
+    } while (seq != frame_seq);
+
+    // Consistent frame - commit it and note which channels moved
+    changed = 0;
+    bit = 1;
+    for (i = 0; i < IBUS_CHANNELS; i++) {
+        if (decoded[i] != channels[i]) {
+            channels[i] = decoded[i];
+            changed |= bit;
+        }
+        bit <<= 1;
     }
+
+    IBUS_STAT_ADD(skipped_frames, (uint8_t)(seq - frame_seq_consumed - 1));
+    frame_seq_consumed = seq;
+    channels_changed = changed;
+    return 1;
+}
+
+// Report the configured failsafe values until valid frames return
+static void ibus_load_failsafe(void) {
+    uint8_t i;
     
-    return 0;
+    for (i = 0; i < IBUS_CHANNELS; i++) {
+        channels[i] = (i < sizeof(failsafe_values) / sizeof(failsafe_values[0])) ?
+                      failsafe_values[i] : 1500;
+    }
+    channels_changed = 0;
+    failsafe = true;
 }
 
 void ibus_init(void) {
+    ibus_load_failsafe();
+    
+#if IBUS_GAP_FRAMING || IBUS_STATS
+    // Timer1 free-running from Fosc/4 with 1:8 prescale = 1us per tick
+    // (gap framing and frame interval statistics; left off when neither reads it)
+    T1GCON = 0x00;
+    T1CON = 0x31;
+#endif
+
     // Enable UART RX interrupt
     PIE1bits.RCIE = 1;
     INTCONbits.PEIE = 1;
@@ -134,86 +339,53 @@ void ibus_init(void) {
 }
 
 uint16_t get_channel_value(uint8_t channel) {
-    uint8_t byte_index;
-    uint16_t value;
+    if (channel < 1 || channel > IBUS_CHANNELS) return 1500;  // Invalid channel
     
-    if (channel < 1 || channel > IBUS_CHANNEL_COUNT) return 1500;  // Invalid channel
-    
-    // Calculate byte index (channel 1 starts at byte 2)
-    byte_index = 2 + ((channel - 1) * 2);
-    
-    // Combine low and high bytes (low byte first in i-Bus)
-    value = (uint16_t)ibus_packet[byte_index] | ((uint16_t)ibus_packet[byte_index + 1] << 8);
-    
-    return value;
+    return channels[channel - 1];
+}
+
+ibus_mask_t ibus_changed_channels(void) {
+    return channels_changed;
+}
+
+bool ibus_in_failsafe(void) {
+    return failsafe;
+}
+
+#if IBUS_STATS
+void ibus_get_stats(ibus_stats_t *stats) {
+    // Counters are 16-bit and written by the ISR - copy with interrupts off
+    INTCONbits.GIE = 0;
+    *stats = ibus_stats;
+    INTCONbits.GIE = 1;
 }
+#endif
 
 void process_ibus_input(void) {
-    static uint16_t last_ch5_value = 0;
-    static uint16_t last_ch6_value = 0;
-    static uint16_t last_ch7_value = 0;  // For volume control
-    static uint8_t ch5_file_index = 0;  // Current file index for channel 5
-    static uint8_t ch6_file_index = 0;  // Current file index for channel 6
+    static uint16_t frame_deadline = 0;  // Failsafe if no valid frame by then
     
-    // Channel 5 file list (6 files)
-    static const char* ch5_files[] = {
-        "AT+PLAYFILE=/tada.mp3\r\n",
-        "AT+PLAYFILE=/3wah.mp3\r\n", 
-        "AT+PLAYFILE=/exclaim.mp3\r\n",
-        "AT+PLAYFILE=/growl.mp3\r\n",
-        "AT+PLAYFILE=/okay.mp3\r\n",
-        "AT+PLAYFILE=/yes.mp3\r\n"
-    };
-    
-    // Channel 6 file list (4 files)
-    static const char* ch6_files[] = {
-        "AT+PLAYFILE=/grumbl02.mp3\r\n",
-        "AT+PLAYFILE=/grumbl03.mp3\r\n",
-        "AT+PLAYFILE=/grumbl04.mp3\r\n",
-        "AT+PLAYFILE=/grumbl05.mp3\r\n"
-    };
-
-    if (!read_ibus_packet()) return;
-    
-    uint16_t ch5_value = get_channel_value(5);
-    uint16_t ch6_value = get_channel_value(6);
-    uint16_t ch7_value = get_channel_value(7);
-    
-    // Handle channel 5 changes
-    if (last_ch5_value != 0 && ch5_value != last_ch5_value) {
-        // Play current file and advance to next
-        dfplayer_send_string(ch5_files[ch5_file_index]);
-        ch5_file_index = (ch5_file_index + 1) % 6;  // Wrap around after 6 files
-        DELAY_milliseconds(100);  // Small delay between commands
-    }
-    
-    // Handle channel 6 changes
-    if (last_ch6_value != 0 && ch6_value != last_ch6_value) {
-        // Play current file and advance to next
-        dfplayer_send_string(ch6_files[ch6_file_index]);
-        ch6_file_index = (ch6_file_index + 1) % 4;  // Wrap around after 4 files
-        DELAY_milliseconds(100);  // Small delay between commands
-    }
-    
-    // Handle channel 7 volume control (pot)
-    if (last_ch7_value != ch7_value) {
-        // Map channel value (1000-2000) to volume (0-30)
-        uint8_t volume;
-        if (ch7_value <= 1000) {
-            volume = 0;
-        } else if (ch7_value >= 2000) {
-            volume = 30;
+    if (read_ibus_packet()) {
+        frame_deadline = scheduler_millis() + IBUS_FAILSAFE_TIMEOUT_MS;
+        
+        // The first frame after boot or failsafe only establishes the switch
+        // positions (no burst of changes); levels pick up their current value
+        if (failsafe) {
+            failsafe = false;
+            channels_changed = 0;
+            actions_reset();
         } else {
-            // Linear interpolation: (ch7_value - 1000) * 30 / (2000 - 1000)
-            volume = ((uint32_t)(ch7_value - 1000) * 30) / 1000;
+            actions_frame(channels_changed);
         }
-        
-        dfplayer_set_volume(volume);
-        DELAY_milliseconds(50);  // Short delay for volume command
+    } else if (!failsafe && scheduler_deadline_reached(frame_deadline)) {
+        // Frames stopped - hold failsafe values and drop actions not yet sent
+        ibus_load_failsafe();
+        actions_cancel();
+        IBUS_STAT_ADD(failsafes, 1);
+#if IBUS_FAILSAFE_TRACK
+        dfplayer_queue_play_number(IBUS_FAILSAFE_TRACK);
+#endif
+        return;
     }
     
-    // Update last values
-    last_ch5_value = ch5_value;
-    last_ch6_value = ch6_value;
-    last_ch7_value = ch7_value;
+    actions_run_pending();
 }
@@ -11,6 +11,38 @@
 
 #include "config.h"
 
+/**
+ * @brief Bitmask of channels, bit 0 = channel 1
+ */
+#if IBUS_CHANNELS > 16
+typedef uint32_t ibus_mask_t;
+#else
+typedef uint16_t ibus_mask_t;
+#endif
+
+#define IBUS_CHANNEL_BIT(channel) ((ibus_mask_t)1 << ((channel) - 1))
+
+#if IBUS_STATS
+/**
+ * @brief i-Bus link statistics (counters wrap at 65535)
+ *
+ * Checksum errors, resyncs and framing errors point at the radio link;
+ * skipped frames and a stretched interval_max point at a busy main loop.
+ */
+typedef struct {
+    uint16_t valid_frames;     // Frames that passed the checksum
+    uint16_t checksum_errors;  // Frames rejected on checksum
+    uint16_t resyncs;          // Frame starts without a valid header
+    uint16_t overruns;         // EUSART overruns (receiver restarted, frame dropped)
+    uint16_t framing_errors;   // Bytes received with a framing error (frame dropped)
+    uint16_t skipped_frames;   // Valid frames superseded before they were decoded
+    uint16_t failsafes;        // Times the link was lost for IBUS_FAILSAFE_TIMEOUT_MS
+    uint16_t interval_min;     // Shortest valid frame to valid frame time in us
+    uint16_t interval_max;     // Longest one (intervals over ~65ms are not measured)
+    uint16_t interval_avg;     // Moving average (1/8 weight) in us, 0 until measured
+} ibus_stats_t;
+#endif
+
 /**
  * @brief Initialize i-Bus reception
  */
@@ -22,10 +54,37 @@ void ibus_init(void);
 void process_ibus_input(void);
 
 /**
- * @brief Get channel value for specified channel
- * @param channel Channel number (1-14)
- * @return Channel value (typically 1000-2000)
+ * @brief Get channel value for specified channel from the last decoded frame
+ * @param channel Channel number (1-IBUS_CHANNELS)
+ * @return Channel value (typically 1000-2000), or its IBUS_FAILSAFE_VALUES
+ *         entry while in failsafe
  */
 uint16_t get_channel_value(uint8_t channel);
 
+/**
+ * @brief Get the channels whose value changed in the last decoded frame
+ * @return Bitmask of changed channels (see IBUS_CHANNEL_BIT)
+ */
+ibus_mask_t ibus_changed_channels(void);
+
+/**
+ * @brief Check whether the link is in failsafe
+ * @return true at boot until the first valid frame, and after no valid frame
+ *         for IBUS_FAILSAFE_TIMEOUT_MS; switch and volume handling is
+ *         suppressed meanwhile
+ */
+bool ibus_in_failsafe(void);
+
+#if IBUS_STATS
+/**
+ * @brief Take a consistent snapshot of the link statistics
+ * @param stats Filled with the current counters
+ * @note Only built with IBUS_STATS
+ * @note Processing is latest-frame-wins: after a stall only the newest frame
+ *       is decoded (see skipped_frames), so reaction time stays within one
+ *       frame period
+ */
+void ibus_get_stats(ibus_stats_t *stats);
+#endif
+
 #endif // IBUS_H
@@ -0,0 +1,56 @@
+/**
+ * @file nvm.c
+ * @brief Data EEPROM access with non-blocking byte writes implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "nvm.h"
+
+// Data EEPROM is mapped at 0xF000-0xF0FF of the NVM address space (NVMREGS = 1)
+#define NVM_EEPROM_ADDRH 0xF0
+
+uint8_t nvm_eeprom_read(uint8_t address) {
+    NVMADRH = NVM_EEPROM_ADDRH;
+    NVMADRL = address;
+    NVMCON1bits.NVMREGS = 1;
+    NVMCON1bits.RD = 1;
+    NOP();
+    NOP();
+    return NVMDATL;
+}
+
+void nvm_eeprom_write(uint8_t address, uint8_t data) {
+    uint8_t gie = INTCONbits.GIE;
+    
+    NVMADRH = NVM_EEPROM_ADDRH;
+    NVMADRL = address;
+    NVMDATL = data;
+    NVMCON1bits.NVMREGS = 1;
+    NVMCON1bits.WREN = 1;
+    
+    // Unlock sequence must not be interrupted
+    INTCONbits.GIE = 0;
+    NVMCON2 = 0x55;
+    NVMCON2 = 0xAA;
+    NVMCON1bits.WR = 1;
+    INTCONbits.GIE = gie;
+    
+    // WR self-clears when the cell is programmed; no need to wait here
+    NVMCON1bits.WREN = 0;
+}
+
+bool nvm_eeprom_busy(void) {
+    return NVMCON1bits.WR;
+}
+
+uint8_t nvm_crc8(uint8_t crc, uint8_t data) {
+    uint8_t i;
+    
+    crc ^= data;
+    for (i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file nvm.h
+ * @brief Data EEPROM access with non-blocking byte writes
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef NVM_H
+#define NVM_H
+
+#include "config.h"
+
+/**
+ * @brief Read one EEPROM byte
+ * @param address EEPROM offset (0-255)
+ * @return Stored byte (0xFF when erased)
+ * @note Do not call while nvm_eeprom_busy()
+ */
+uint8_t nvm_eeprom_read(uint8_t address);
+
+/**
+ * @brief Start writing one EEPROM byte and return immediately
+ * @param address EEPROM offset (0-255)
+ * @param data Byte to store
+ * @note The write takes ~4ms; poll nvm_eeprom_busy() before the next access
+ */
+void nvm_eeprom_write(uint8_t address, uint8_t data);
+
+/**
+ * @brief Check whether a write started by nvm_eeprom_write() is still running
+ * @return true while the EEPROM is busy
+ */
+bool nvm_eeprom_busy(void);
+
+/**
+ * @brief Fold one byte into a CRC-8 (polynomial 0x07)
+ * @param crc Running CRC (start with 0)
+ * @param data Next byte
+ * @return Updated CRC
+ */
+uint8_t nvm_crc8(uint8_t crc, uint8_t data);
+
+#endif // NVM_H
@@ -0,0 +1,65 @@
+/**
+ * @file playlists.h
+ * @brief Playlist tables generated by tools/playlist_gen.py - do not edit
+ *
+ * Generated from playlists.txt and sdcard.txt.
+ * Run `make playlists` after changing the manifest or re-imaging the SD card.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef PLAYLISTS_H
+#define PLAYLISTS_H
+
+#include "dfplayer.h"
+
+// Number of files on the SD card the tables were generated for
+// (checked against the DFPlayer at startup by actions_check_sdcard())
+#define PLAYLIST_SDCARD_FILE_COUNT 11
+
+typedef struct {
+    const uint8_t *numbers;
+#if PLAYLIST_PLAY_BY_NAME
+    const char (*names)[DFPLAYER_NAME_SIZE];
+#endif
+    uint8_t length;
+} playlist_t;
+
+// Playlist ch5
+#define PLAYLIST_CH5_LENGTH 6
+static const uint8_t playlist_ch5[PLAYLIST_CH5_LENGTH] = {
+    2, 3, 4, 5, 6, 7
+};
+#if PLAYLIST_PLAY_BY_NAME
+static const char playlist_ch5_names[PLAYLIST_CH5_LENGTH][DFPLAYER_NAME_SIZE] = {
+    "tada", "3wah", "exclaim", "growl", "okay", "yes"
+};
+#endif
+
+// Playlist ch6
+#define PLAYLIST_CH6_LENGTH 4
+static const uint8_t playlist_ch6[PLAYLIST_CH6_LENGTH] = {
+    8, 9, 10, 11
+};
+#if PLAYLIST_PLAY_BY_NAME
+static const char playlist_ch6_names[PLAYLIST_CH6_LENGTH][DFPLAYER_NAME_SIZE] = {
+    "grumbl02", "grumbl03", "grumbl04", "grumbl05"
+};
+#endif
+
+// Playlist directory, indexed by PLAYLIST_ID_<NAME>
+#define PLAYLIST_COUNT 2
+#define PLAYLIST_ID_CH5 0
+#define PLAYLIST_ID_CH6 1
+static const playlist_t playlist_table[PLAYLIST_COUNT] = {
+#if PLAYLIST_PLAY_BY_NAME
+    { playlist_ch5, playlist_ch5_names, PLAYLIST_CH5_LENGTH },
+    { playlist_ch6, playlist_ch6_names, PLAYLIST_CH6_LENGTH },
+#else
+    { playlist_ch5, PLAYLIST_CH5_LENGTH },
+    { playlist_ch6, PLAYLIST_CH6_LENGTH },
+#endif
+};
+
+#endif // PLAYLISTS_H
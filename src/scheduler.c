@@ -0,0 +1,112 @@
+/**
+ * @file scheduler.c
+ * @brief Millisecond tick and cooperative run-to-completion task scheduler implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "scheduler.h"
+
+typedef struct {
+    scheduler_task_t task;
+    uint16_t period;
+    uint16_t next_run;
+} scheduler_slot_t;
+
+static scheduler_slot_t tasks[SCHEDULER_MAX_TASKS];
+static uint8_t task_count = 0;
+
+// Incremented every 1ms by the Timer0 interrupt
+static volatile uint16_t tick_ms = 0;
+
+// Set from ISRs when there is something for the tasks to do
+static volatile bool work_pending = true;
+
+void scheduler_init(void) {
+    // Timer0 8-bit mode: Fosc/4 / 32 = 250kHz, period 250 counts = 1ms
+    T0CON1 = 0x45;   // T0CS Fosc/4, synchronous, 1:32 prescale
+    TMR0H = 249;     // Period compare value
+    TMR0L = 0;
+    T0CON0 = 0x80;   // T0EN, 8-bit, 1:1 postscale
+    
+#if SCHEDULER_IDLE
+    CPUDOZEbits.IDLEN = 1;  // SLEEP enters IDLE: peripherals and interrupts keep running
+#endif
+    
+    PIR0bits.TMR0IF = 0;
+    PIE0bits.TMR0IE = 1;
+}
+
+uint8_t scheduler_add(scheduler_task_t task, uint16_t period_ms) {
+    if (task_count >= SCHEDULER_MAX_TASKS) return 0xFF;
+    
+    tasks[task_count].task = task;
+    tasks[task_count].period = period_ms;
+    tasks[task_count].next_run = scheduler_millis();
+    return task_count++;
+}
+
+void scheduler_defer(uint8_t id, uint16_t delay_ms) {
+    if (id >= task_count) return;
+    
+    tasks[id].next_run = scheduler_millis() + delay_ms;
+}
+
+void scheduler_run(void) {
+    uint8_t i;
+    
+    for (i = 0; i < task_count; i++) {
+        scheduler_slot_t *slot = &tasks[i];
+        
+        if (!scheduler_deadline_reached(slot->next_run)) continue;
+        
+        // Schedule from the previous deadline so periodic tasks don't drift
+        slot->next_run += slot->period;
+        if (slot->period == 0 || scheduler_deadline_reached(slot->next_run)) {
+            slot->next_run = scheduler_millis() + slot->period;
+        }
+        slot->task();
+    }
+}
+
+void scheduler_idle(void) {
+#if SCHEDULER_IDLE
+    // With GIE clear a pending interrupt still ends IDLE but is not vectored,
+    // so a wake-up raised after the check cannot be slept through
+    INTCONbits.GIE = 0;
+    while (!work_pending) {
+        SLEEP();
+        NOP();
+        INTCONbits.GIE = 1;  // Service whatever woke us
+        NOP();
+        INTCONbits.GIE = 0;
+    }
+    work_pending = false;
+    INTCONbits.GIE = 1;
+#endif
+}
+
+void scheduler_wake(void) {
+    work_pending = true;
+}
+
+uint16_t scheduler_millis(void) {
+    uint16_t now;
+    
+    // 16-bit read is not atomic on this core - retry if the ISR ticked
+    do {
+        now = tick_ms;
+    } while (now != tick_ms);
+    return now;
+}
+
+bool scheduler_deadline_reached(uint16_t deadline) {
+    return (int16_t)(scheduler_millis() - deadline) >= 0;
+}
+
+void scheduler_tick_isr(void) {
+    PIR0bits.TMR0IF = 0;
+    tick_ms++;
+    work_pending = true;  // Deadlines are checked once per tick
+}
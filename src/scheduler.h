@@ -0,0 +1,75 @@
+/**
+ * @file scheduler.h
+ * @brief Millisecond tick and cooperative run-to-completion task scheduler
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "config.h"
+
+/**
+ * @brief Task function; must run to completion without blocking
+ */
+typedef void (*scheduler_task_t)(void);
+
+/**
+ * @brief Start the Timer0 1ms tick
+ */
+void scheduler_init(void);
+
+/**
+ * @brief Register a task
+ * @param task Function to call
+ * @param period_ms Run interval in ms (0 = every pass of the main loop)
+ * @return Task id for scheduler_defer(), or 0xFF if the task table is full
+ */
+uint8_t scheduler_add(scheduler_task_t task, uint16_t period_ms);
+
+/**
+ * @brief Postpone a task's next run
+ * @param id Task id returned by scheduler_add()
+ * @param delay_ms Do not run the task before now + delay_ms
+ */
+void scheduler_defer(uint8_t id, uint16_t delay_ms);
+
+/**
+ * @brief Run every task whose deadline has been reached (call from main loop)
+ */
+void scheduler_run(void);
+
+/**
+ * @brief Wait in IDLE until an interrupt signals new work (call from main loop)
+ * @note With SCHEDULER_IDLE the CPU core stops while peripherals keep running;
+ *       interrupts that do not call scheduler_wake() go back to IDLE without
+ *       running a scheduler pass
+ */
+void scheduler_idle(void);
+
+/**
+ * @brief Request a scheduler pass (call from ISR when work becomes available)
+ */
+void scheduler_wake(void);
+
+/**
+ * @brief Get milliseconds since scheduler_init() (wraps every ~65s)
+ * @return Current tick count
+ */
+uint16_t scheduler_millis(void);
+
+/**
+ * @brief Check whether a deadline from scheduler_millis() has passed
+ * @param deadline Tick value to compare against (wrap-safe within ~32s)
+ * @return true once scheduler_millis() >= deadline
+ */
+bool scheduler_deadline_reached(uint16_t deadline);
+
+/**
+ * @brief Advance the tick (call from ISR on TMR0IF)
+ */
+void scheduler_tick_isr(void);
+
+#endif // SCHEDULER_H
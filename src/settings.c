@@ -0,0 +1,137 @@
+/**
+ * @file settings.c
+ * @brief Persistent settings in a wear-levelled, CRC-protected EEPROM record ring implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "settings.h"
+#include "nvm.h"
+#include "scheduler.h"
+
+// Record layout: seq, version, volume, playlist positions, CRC-8 of the rest
+#define REC_SEQ 0
+#define REC_VERSION 1
+#define REC_VOLUME 2
+#define REC_PLAYLIST 3
+#define REC_CRC (REC_PLAYLIST + SETTINGS_PLAYLIST_SLOTS)
+#define REC_SIZE (REC_CRC + 1)
+#define SETTINGS_SLOTS (SETTINGS_EEPROM_SIZE / REC_SIZE)
+
+#if SETTINGS_SLOTS < 2
+#error "SETTINGS_EEPROM_SIZE must hold at least two records"
+#endif
+
+// Current values, laid out as record bytes REC_VOLUME..REC_CRC-1
+#define VAL_VOLUME (REC_VOLUME - REC_VOLUME)
+#define VAL_PLAYLIST (REC_PLAYLIST - REC_VOLUME)
+static uint8_t values[REC_CRC - REC_VOLUME] = { DFPLAYER_VOLUME_DEFAULT };
+
+static uint8_t slot = SETTINGS_SLOTS - 1;  // Slot of the newest record
+static uint8_t seq = 0;                    // Its sequence number
+
+// Background save: next record byte to write and the CRC of those before it
+static uint8_t write_pos = REC_SIZE;       // REC_SIZE = nothing being written
+static uint8_t write_crc = 0;
+static bool dirty = false;
+static uint16_t save_at = 0;
+
+bool settings_load(void) {
+    uint8_t s;
+    uint8_t i;
+    uint8_t address = SETTINGS_EEPROM_BASE;
+    bool found = false;
+    
+    for (s = 0; s < SETTINGS_SLOTS; s++, address += REC_SIZE) {
+        uint8_t crc = 0;
+        uint8_t rec_seq = nvm_eeprom_read(address + REC_SEQ);
+        
+        for (i = 0; i < REC_CRC; i++) {
+            crc = nvm_crc8(crc, nvm_eeprom_read(address + i));
+        }
+        if (nvm_eeprom_read(address + REC_VERSION) != SETTINGS_VERSION) continue;  // Erased or old layout
+        if (crc != nvm_eeprom_read(address + REC_CRC)) continue;
+        
+        // Newest by serial number arithmetic, so the sequence may wrap
+        if (found && (int8_t)(rec_seq - seq) <= 0) continue;
+        
+        found = true;
+        slot = s;
+        seq = rec_seq;
+        for (i = 0; i < sizeof(values); i++) {
+            values[i] = nvm_eeprom_read(address + REC_VOLUME + i);
+        }
+    }
+    return found;
+}
+
+// Note a change and restart the settle timer
+static void settings_update(uint8_t index, uint8_t value) {
+    if (values[index] == value) return;
+    
+    values[index] = value;
+    dirty = true;
+    save_at = scheduler_millis() + SETTINGS_SAVE_DELAY_MS;
+}
+
+// Byte of the record being saved (the CRC covers the bytes written before it)
+static uint8_t settings_record_byte(uint8_t pos) {
+    if (pos == REC_SEQ) return seq;
+    if (pos == REC_VERSION) return SETTINGS_VERSION;
+    if (pos == REC_CRC) return write_crc;
+    return values[pos - REC_VOLUME];
+}
+
+void settings_task(void) {
+    uint8_t address;
+    uint8_t data;
+    
+    if (write_pos < REC_SIZE) {
+        if (nvm_eeprom_busy()) return;
+        
+        // One byte per pass; bytes that already match cost no write cycle.
+        // Each byte is taken from the live values as it goes out and folded
+        // into the CRC, so no snapshot is kept; a value changed mid-save is
+        // marked dirty and saved again after the settle delay.
+        address = SETTINGS_EEPROM_BASE + slot * REC_SIZE + write_pos;
+        do {
+            data = settings_record_byte(write_pos);
+            write_crc = nvm_crc8(write_crc, data);
+            write_pos++;
+            if (nvm_eeprom_read(address) != data) {
+                nvm_eeprom_write(address, data);
+                return;
+            }
+            address++;
+        } while (write_pos < REC_SIZE);
+        return;
+    }
+    
+    if (!dirty || !scheduler_deadline_reached(save_at)) return;
+    dirty = false;
+    
+    // Start a record in the next slot of the ring
+    slot = (slot + 1 >= SETTINGS_SLOTS) ? 0 : slot + 1;
+    seq++;
+    write_crc = 0;
+    write_pos = 0;
+}
+
+uint8_t settings_get_volume(void) {
+    return values[VAL_VOLUME];
+}
+
+void settings_set_volume(uint8_t volume) {
+    settings_update(VAL_VOLUME, volume);
+}
+
+uint8_t settings_get_playlist_pos(uint8_t playlist) {
+    if (playlist >= SETTINGS_PLAYLIST_SLOTS) return 0;
+    return values[VAL_PLAYLIST + playlist];
+}
+
+void settings_set_playlist_pos(uint8_t playlist, uint8_t pos) {
+    if (playlist >= SETTINGS_PLAYLIST_SLOTS) return;
+    settings_update(VAL_PLAYLIST + playlist, pos);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file settings.h
+ * @brief Persistent settings in a wear-levelled, CRC-protected EEPROM record ring
+ *
+ * Each save writes a whole record (sequence, version, values, CRC-8) to the
+ * next slot of the ring, one byte per scheduler pass while the EEPROM is
+ * idle, so the ~4ms write time never stalls the main loop. The CRC goes
+ * last: a save cut short by power loss leaves the previous record in force.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "config.h"
+
+#define SETTINGS_VERSION 1  // Bump when the record layout changes
+
+/**
+ * @brief Load the newest valid record (single pass over the ring)
+ * @return false if none was found and the defaults are in use
+ */
+bool settings_load(void);
+
+/**
+ * @brief Write pending changes in the background (scheduler task, period 0)
+ */
+void settings_task(void);
+
+/**
+ * @brief Get the stored volume
+ * @return Volume level (0-30), DFPLAYER_VOLUME_DEFAULT if nothing was stored
+ */
+uint8_t settings_get_volume(void);
+
+/**
+ * @brief Remember the volume (saved after SETTINGS_SAVE_DELAY_MS without change)
+ * @param volume Volume level (0-30)
+ */
+void settings_set_volume(uint8_t volume);
+
+/**
+ * @brief Get a stored playlist position
+ * @param playlist Playlist id (PLAYLIST_ID_<NAME>)
+ * @return Next file index, 0 if nothing was stored
+ */
+uint8_t settings_get_playlist_pos(uint8_t playlist);
+
+/**
+ * @brief Remember a playlist position (saved after SETTINGS_SAVE_DELAY_MS without change)
+ * @param playlist Playlist id (PLAYLIST_ID_<NAME>), below SETTINGS_PLAYLIST_SLOTS
+ * @param pos Next file index
+ */
+void settings_set_playlist_pos(uint8_t playlist, uint8_t pos);
+
+#endif // SETTINGS_H
@@ -0,0 +1,31 @@
+/**
+ * @file trigger_program.h
+ * @brief Trigger bytecode generated by tools/trigger_compile.py - do not edit
+ *
+ * Generated from triggers.txt.
+ * Run `make triggers` after changing the script.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef TRIGGER_PROGRAM_H
+#define TRIGGER_PROGRAM_H
+
+#include "trigger_vm.h"
+
+#define TRIGGER_PROGRAM_SIZE 1
+#define TRIGGER_PROGRAM_VARS 0
+#define TRIGGER_PROGRAM_STACK 0
+#define TRIGGER_PROGRAM_STEPS 1
+#define TRIGGER_PROGRAM_MAX_CHANNEL 0
+#define TRIGGER_PROGRAM_MAX_RULE -1  // -1 = no fire()
+
+// actions.c only needs the limits above
+#ifndef TRIGGER_PROGRAM_LIMITS_ONLY
+static const uint8_t trigger_program[TRIGGER_PROGRAM_SIZE] = {
+    0x00,
+};
+#endif
+
+#endif // TRIGGER_PROGRAM_H
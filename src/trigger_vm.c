@@ -0,0 +1,119 @@
+/**
+ * @file trigger_vm.c
+ * @brief Bytecode interpreter for conditional trigger scripts implementation
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include "trigger_vm.h"
+#include "trigger_program.h"
+#include "actions.h"
+#include "scheduler.h"
+
+#if TRIGGER_PROGRAM_VARS > TRIGGER_VM_VARS
+#error "Trigger script uses more variables than TRIGGER_VM_VARS"
+#endif
+#if TRIGGER_PROGRAM_STACK > TRIGGER_VM_STACK
+#error "Trigger script needs a deeper stack than TRIGGER_VM_STACK"
+#endif
+#if TRIGGER_PROGRAM_STEPS > TRIGGER_VM_MAX_STEPS
+#error "Trigger script's longest path exceeds TRIGGER_VM_MAX_STEPS; run make triggers"
+#endif
+#if TRIGGER_PROGRAM_MAX_CHANNEL > IBUS_CHANNELS
+#error "Trigger script reads a channel above IBUS_CHANNELS"
+#endif
+
+// Host benchmark hook (tools/trigger_bench.c), called for each instruction
+#ifndef TRIGGER_VM_TRACE
+#define TRIGGER_VM_TRACE(op)
+#endif
+
+// RAM is sized to the compiled script; the config values are the limits
+#define VM_VARS (TRIGGER_PROGRAM_VARS ? TRIGGER_PROGRAM_VARS : 1)
+#define VM_STACK (TRIGGER_PROGRAM_STACK ? TRIGGER_PROGRAM_STACK : 1)
+
+// Script variables persist across frames
+static uint16_t vm_vars[VM_VARS];
+
+uint8_t trigger_vm_run(ibus_mask_t changed, ibus_mask_t edges) {
+    uint16_t stack[VM_STACK];
+    uint8_t sp = 0;  // Next free stack slot
+    uint8_t pc = 0;
+    uint8_t steps = 0;
+    uint16_t a;
+    uint16_t b;
+    
+    // The compiler checks stack depth and jump targets, so the loop only
+    // guards the program end and the step budget
+    while (pc < TRIGGER_PROGRAM_SIZE && steps < TRIGGER_VM_MAX_STEPS) {
+        uint8_t op = trigger_program[pc++];
+        steps++;
+        TRIGGER_VM_TRACE(op);
+        
+        if (op >= VM_ADD && op <= VM_OR && op != VM_NOT) {
+            // Binary operators: b on top, a below it
+            b = stack[--sp];
+            a = stack[sp - 1];
+            switch (op) {
+                case VM_ADD: a = a + b; break;
+                case VM_SUB: a = a - b; break;
+                case VM_LT:  a = a < b; break;
+                case VM_GT:  a = a > b; break;
+                case VM_EQ:  a = a == b; break;
+                case VM_AND: a = a && b; break;
+                default:     a = a || b; break;
+            }
+            stack[sp - 1] = a;
+            continue;
+        }
+        
+        switch (op) {
+            case VM_PUSH8:
+                a = trigger_program[pc++];
+                break;
+            case VM_PUSH16:
+                a = trigger_program[pc] | ((uint16_t)trigger_program[pc + 1] << 8);
+                pc += 2;
+                break;
+            case VM_CH:
+                a = get_channel_value(trigger_program[pc++]);
+                break;
+            case VM_POS:
+                a = actions_switch_position(trigger_program[pc++]);
+                break;
+            case VM_EDGE:
+                a = (edges & IBUS_CHANNEL_BIT(trigger_program[pc++])) != 0;
+                break;
+            case VM_CHANGED:
+                a = (changed & IBUS_CHANNEL_BIT(trigger_program[pc++])) != 0;
+                break;
+            case VM_MS:
+                a = scheduler_millis();
+                break;
+            case VM_LOAD:
+                a = vm_vars[trigger_program[pc++]];
+                break;
+            case VM_STORE:
+                vm_vars[trigger_program[pc++]] = stack[--sp];
+                continue;
+            case VM_NOT:
+                stack[sp - 1] = !stack[sp - 1];
+                continue;
+            case VM_JZ:
+                b = trigger_program[pc++];
+                if (stack[--sp] == 0) pc += b;
+                continue;
+            case VM_JMP:
+                pc += trigger_program[pc] + 1;
+                continue;
+            case VM_FIRE:
+                actions_fire(trigger_program[pc++]);
+                continue;
+            default:
+                return steps;  // VM_END or an unknown opcode
+        }
+        stack[sp++] = a;
+    }
+    return steps;
+}
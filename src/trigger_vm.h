@@ -0,0 +1,53 @@
+/**
+ * @file trigger_vm.h
+ * @brief Bytecode interpreter for conditional trigger scripts
+ *
+ * Scripts (tools/triggers.txt) are compiled on the host by
+ * tools/trigger_compile.py into src/trigger_program.h. The VM runs the
+ * program once per decoded frame: a stack machine over 16-bit values with
+ * forward-only jumps, so a run never exceeds the program length, and a hard
+ * TRIGGER_VM_MAX_STEPS budget on top. Scripts act by firing rules of the
+ * action table (ACTION_ON_SCRIPT), so new behaviours cost data bytes only.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#ifndef TRIGGER_VM_H
+#define TRIGGER_VM_H
+
+#include "config.h"
+#include "ibus.h"
+
+// Opcodes (operand bytes in brackets) - keep in step with tools/trigger_compile.py
+#define VM_END 0x00      // Stop
+#define VM_PUSH8 0x01    // [n] push n
+#define VM_PUSH16 0x02   // [lo hi] push n
+#define VM_CH 0x03       // [channel] push channel value
+#define VM_POS 0x04      // [channel] push switch position (0xFF if not a switch)
+#define VM_EDGE 0x05     // [channel] push 1 if the switch moved this frame
+#define VM_CHANGED 0x06  // [channel] push 1 if the channel value changed this frame
+#define VM_MS 0x07       // push scheduler_millis()
+#define VM_LOAD 0x08     // [var] push variable
+#define VM_STORE 0x09    // [var] pop into variable
+#define VM_ADD 0x0A      // a + b
+#define VM_SUB 0x0B      // a - b (wraps, so ms differences work)
+#define VM_LT 0x0C       // a < b
+#define VM_GT 0x0D       // a > b
+#define VM_EQ 0x0E       // a == b
+#define VM_NOT 0x0F      // !a
+#define VM_AND 0x10      // a && b
+#define VM_OR 0x11       // a || b
+#define VM_JZ 0x12       // [offset] pop; skip offset bytes forward if zero
+#define VM_JMP 0x13      // [offset] skip offset bytes forward
+#define VM_FIRE 0x14     // [rule] queue action rule
+
+/**
+ * @brief Run the trigger program for one decoded frame
+ * @param changed Channels whose value changed in this frame
+ * @param edges Switch channels that reached a new confirmed position
+ * @return Instructions executed (at most TRIGGER_VM_MAX_STEPS)
+ */
+uint8_t trigger_vm_run(ibus_mask_t changed, ibus_mask_t edges);
+
+#endif // TRIGGER_VM_H
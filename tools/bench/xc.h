@@ -0,0 +1,10 @@
+/**
+ * @file xc.h
+ * @brief Empty stand-in for the XC8 device header in host builds
+ *
+ * Lets host tools (tools/trigger_bench.c) compile firmware modules that do
+ * not touch special function registers.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Generate src/playlists.h from a playlist manifest and an SD card listing.
+
+Usage: playlist_gen.py <manifest> <sdcard listing> <output header>
+
+The DFPlayer numbers files in FAT directory order, so the listing must be in
+the order the files were copied to the card. Each playlist becomes a ROM table
+of file numbers for AT+PLAYNUM plus a compile-time length constant, and a
+table of packed 8-byte base names for AT+PLAYFILE builds. A directory table
+indexed by PLAYLIST_ID_<NAME> lets action rules refer to playlists by number.
+"""
+
+import os
+import sys
+
+NAME_SIZE = 8  # DFPLAYER_NAME_SIZE
+
+
+def read_lines(path):
+    with open(path) as f:
+        for line_no, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].strip()
+            if line:
+                yield line_no, line
+
+
+def fail(path, line_no, message):
+    sys.exit('%s:%d: %s' % (path, line_no, message))
+
+
+def load_listing(path):
+    numbers = {}
+    count = 0
+    for line_no, line in read_lines(path):
+        count += 1
+        key = line.lstrip('/').lower()
+        if key in numbers:
+            fail(path, line_no, 'duplicate file %s' % line)
+        numbers[key] = count
+    if count > 255:
+        fail(path, count, 'more than 255 files; AT+PLAYNUM argument is 8-bit')
+    return numbers, count
+
+
+def load_manifest(path, numbers):
+    playlists = []
+    for line_no, line in read_lines(path):
+        fields = line.split()
+        name, files = fields[0], fields[1:]
+        if not name.isidentifier():
+            fail(path, line_no, 'playlist name %s is not a C identifier' % name)
+        if not files:
+            fail(path, line_no, 'playlist %s is empty' % name)
+        entries = []
+        for file in files:
+            key = file.lstrip('/').lower()
+            if key not in numbers:
+                fail(path, line_no, '%s is not on the SD card listing' % file)
+            base = os.path.splitext(file.lstrip('/'))[0]
+            if '/' in base or len(base) > NAME_SIZE or not file.lower().endswith('.mp3'):
+                fail(path, line_no, '%s is not a root-level 8.3 .mp3 name' % file)
+            entries.append((numbers[key], base))
+        playlists.append((name, entries))
+    return playlists
+
+
+def render(playlists, file_count, sources):
+    out = []
+    out.append('/**')
+    out.append(' * @file playlists.h')
+    out.append(' * @brief Playlist tables generated by tools/playlist_gen.py - do not edit')
+    out.append(' *')
+    out.append(' * Generated from %s.' % ' and '.join(sources))
+    out.append(' * Run `make playlists` after changing the manifest or re-imaging the SD card.')
+    out.append(' *')
+    out.append(' * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project')
+    out.append(' * @license MIT License - see LICENSE file for details')
+    out.append(' */')
+    out.append('')
+    out.append('#ifndef PLAYLISTS_H')
+    out.append('#define PLAYLISTS_H')
+    out.append('')
+    out.append('#include "dfplayer.h"')
+    out.append('')
+    out.append('// Number of files on the SD card the tables were generated for')
+    out.append('// (checked against the DFPlayer at startup by actions_check_sdcard())')
+    out.append('#define PLAYLIST_SDCARD_FILE_COUNT %d' % file_count)
+    out.append('')
+    out.append('typedef struct {')
+    out.append('    const uint8_t *numbers;')
+    out.append('#if PLAYLIST_PLAY_BY_NAME')
+    out.append('    const char (*names)[DFPLAYER_NAME_SIZE];')
+    out.append('#endif')
+    out.append('    uint8_t length;')
+    out.append('} playlist_t;')
+    for name, entries in playlists:
+        upper = name.upper()
+        out.append('')
+        out.append('// Playlist %s' % name)
+        out.append('#define PLAYLIST_%s_LENGTH %d' % (upper, len(entries)))
+        out.append('static const uint8_t playlist_%s[PLAYLIST_%s_LENGTH] = {' % (name, upper))
+        out.append('    ' + ', '.join('%d' % number for number, _ in entries))
+        out.append('};')
+        out.append('#if PLAYLIST_PLAY_BY_NAME')
+        out.append('static const char playlist_%s_names[PLAYLIST_%s_LENGTH][DFPLAYER_NAME_SIZE] = {' % (name, upper))
+        out.append('    ' + ', '.join('"%s"' % base for _, base in entries))
+        out.append('};')
+        out.append('#endif')
+    out.append('')
+    out.append('// Playlist directory, indexed by PLAYLIST_ID_<NAME>')
+    out.append('#define PLAYLIST_COUNT %d' % len(playlists))
+    for index, (name, _) in enumerate(playlists):
+        out.append('#define PLAYLIST_ID_%s %d' % (name.upper(), index))
+    out.append('static const playlist_t playlist_table[PLAYLIST_COUNT] = {')
+    out.append('#if PLAYLIST_PLAY_BY_NAME')
+    for name, _ in playlists:
+        out.append('    { playlist_%s, playlist_%s_names, PLAYLIST_%s_LENGTH },' % (name, name, name.upper()))
+    out.append('#else')
+    for name, _ in playlists:
+        out.append('    { playlist_%s, PLAYLIST_%s_LENGTH },' % (name, name.upper()))
+    out.append('#endif')
+    out.append('};')
+    out.append('')
+    out.append('#endif // PLAYLISTS_H')
+    return '\n'.join(out) + '\n'
+
+
+def main(argv):
+    if len(argv) != 4:
+        sys.exit(__doc__.strip().splitlines()[2])
+    manifest, listing, output = argv[1:]
+    numbers, file_count = load_listing(listing)
+    playlists = load_manifest(manifest, numbers)
+    sources = [os.path.basename(manifest), os.path.basename(listing)]
+    with open(output, 'w', newline='\n') as f:
+        f.write(render(playlists, file_count, sources))
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -0,0 +1,122 @@
+/**
+ * @file trigger_bench.c
+ * @brief Host benchmark for the trigger script VM (`make trigger-bench`)
+ *
+ * Builds src/trigger_vm.c natively around the generated src/trigger_program.h,
+ * feeds it a synthetic frame stream with jittering switches, and reports
+ * instructions per frame and an estimated PIC16 cycle cost per frame. The
+ * per-opcode cycle weights are estimates for XC8 output; recalibrate them
+ * against the MPLAB simulator stopwatch when the compiler version changes.
+ *
+ * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project
+ * @license MIT License - see LICENSE file for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long op_count[256];
+#define TRIGGER_VM_TRACE(op) (op_count[(op)]++)
+
+#include "../src/trigger_vm.c"
+
+#define BENCH_FRAMES 100000UL
+#define BENCH_FRAME_MS 7
+#define BENCH_MIPS 8  // 32 MHz Fosc / 4
+
+// Estimated instruction cycles per opcode, dispatch included. These are
+// hand estimates, not simulator measurements - treat the cycle totals as a
+// rough guide and the instruction counts as exact
+static const unsigned op_cycles[] = {
+    [VM_END] = 20, [VM_PUSH8] = 30, [VM_PUSH16] = 40, [VM_CH] = 55, [VM_POS] = 70,
+    [VM_EDGE] = 50, [VM_CHANGED] = 50, [VM_MS] = 45, [VM_LOAD] = 35, [VM_STORE] = 35,
+    [VM_ADD] = 40, [VM_SUB] = 40, [VM_LT] = 45, [VM_GT] = 45, [VM_EQ] = 45,
+    [VM_NOT] = 30, [VM_AND] = 45, [VM_OR] = 45, [VM_JZ] = 35, [VM_JMP] = 25,
+    [VM_FIRE] = 40,
+};
+
+static const char *const op_names[] = {
+    "END", "PUSH8", "PUSH16", "CH", "POS", "EDGE", "CHANGED", "MS", "LOAD",
+    "STORE", "ADD", "SUB", "LT", "GT", "EQ", "NOT", "AND", "OR", "JZ", "JMP", "FIRE",
+};
+
+static uint16_t channels[IBUS_CHANNELS];
+static uint8_t positions[IBUS_CHANNELS];
+static uint16_t now_ms;
+static unsigned long fired;
+
+uint16_t get_channel_value(uint8_t channel) {
+    return channels[channel - 1];
+}
+
+uint8_t actions_switch_position(uint8_t channel) {
+    return positions[channel - 1];
+}
+
+void actions_fire(uint8_t rule) {
+    (void)rule;
+    fired++;
+}
+
+uint16_t scheduler_millis(void) {
+    return now_ms;
+}
+
+int main(void) {
+    unsigned long frame;
+    unsigned long total_steps = 0;
+    unsigned long total_cycles = 0;
+    unsigned long max_cycles = 0;
+    unsigned max_steps = 0;
+    unsigned op;
+
+    srand(1);
+    for (frame = 0; frame < BENCH_FRAMES; frame++) {
+        ibus_mask_t changed = 0;
+        ibus_mask_t edges = 0;
+        unsigned long before = 0;
+        unsigned long after = 0;
+        uint8_t channel;
+        uint8_t steps;
+
+        for (op = 0; op < sizeof(op_cycles) / sizeof(op_cycles[0]); op++) {
+            before += op_count[op] * op_cycles[op];
+        }
+
+        // Every channel jitters; switches move now and then
+        for (channel = 1; channel <= IBUS_CHANNELS; channel++) {
+            uint16_t value = (uint16_t)(1000 + positions[channel - 1] * 500 + rand() % 5);
+            if (rand() % 50 == 0) {
+                positions[channel - 1] = (uint8_t)(rand() % 3);
+                edges |= IBUS_CHANNEL_BIT(channel);
+            }
+            if (value != channels[channel - 1]) changed |= IBUS_CHANNEL_BIT(channel);
+            channels[channel - 1] = value;
+        }
+        now_ms = (uint16_t)(now_ms + BENCH_FRAME_MS);
+
+        steps = trigger_vm_run(changed, edges);
+
+        for (op = 0; op < sizeof(op_cycles) / sizeof(op_cycles[0]); op++) {
+            after += op_count[op] * op_cycles[op];
+        }
+        total_steps += steps;
+        total_cycles += after - before;
+        if (steps > max_steps) max_steps = steps;
+        if (after - before > max_cycles) max_cycles = after - before;
+    }
+
+    printf("program: %d bytes, %d vars, stack %d\n",
+           TRIGGER_PROGRAM_SIZE, TRIGGER_PROGRAM_VARS, TRIGGER_PROGRAM_STACK);
+    printf("frames: %lu, rules fired: %lu\n", BENCH_FRAMES, fired);
+    printf("instructions/frame: avg %.1f, max %u (longest path %d, budget %d)\n",
+           (double)total_steps / BENCH_FRAMES, max_steps, TRIGGER_PROGRAM_STEPS,
+           TRIGGER_VM_MAX_STEPS);
+    printf("cycles/frame (estimated): avg %.0f, max %lu (%.1f us at %d MIPS)\n",
+           (double)total_cycles / BENCH_FRAMES, max_cycles,
+           (double)max_cycles / BENCH_MIPS, BENCH_MIPS);
+    for (op = 0; op < sizeof(op_names) / sizeof(op_names[0]); op++) {
+        if (op_count[op]) printf("  %-8s %lu\n", op_names[op], op_count[op]);
+    }
+    return 0;
+}
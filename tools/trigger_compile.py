@@ -0,0 +1,286 @@
+#!/usr/bin/env python3
+"""Compile a trigger script into bytecode for src/trigger_vm.c.
+
+Usage: trigger_compile.py <script> <output header>
+
+IBUS_CHANNELS and TRIGGER_VM_MAX_STEPS are read from config.h next to the
+output header.
+
+Scripts use a small Python-like language, run once per decoded i-Bus frame:
+
+    if edge(5) and pos(6) == 2:     # ch5 moved while switch ch6 is at 2000
+        fire(1)                     # queue rule 1 of src/action_rules.h
+    if edge(6):
+        if ms - last < 500:         # second ch6 toggle within 500 ms
+            fire(0)
+        last = ms
+
+Values are unsigned 16-bit. Expressions: integer constants, variables, ms,
+ch(n), pos(n), edge(n), changed(n), + -, < > <= >= == !=, and or not.
+Statements: assignment, if/elif/else, fire(rule), pass. Variables keep their
+value across frames and start at 0. There are no loops, and all jumps go
+forward, so the longest path through the program bounds every run; scripts
+whose longest path exceeds TRIGGER_VM_MAX_STEPS are rejected.
+"""
+
+import ast
+import os
+import re
+import sys
+
+# Opcodes - keep in step with src/trigger_vm.h
+OPS = {
+    'END': 0x00, 'PUSH8': 0x01, 'PUSH16': 0x02, 'CH': 0x03, 'POS': 0x04,
+    'EDGE': 0x05, 'CHANGED': 0x06, 'MS': 0x07, 'LOAD': 0x08, 'STORE': 0x09,
+    'ADD': 0x0A, 'SUB': 0x0B, 'LT': 0x0C, 'GT': 0x0D, 'EQ': 0x0E, 'NOT': 0x0F,
+    'AND': 0x10, 'OR': 0x11, 'JZ': 0x12, 'JMP': 0x13, 'FIRE': 0x14,
+}
+
+CHANNEL_FUNCS = {'ch': 'CH', 'pos': 'POS', 'edge': 'EDGE', 'changed': 'CHANGED'}
+# Operand bytes following each opcode
+OPERANDS = {
+    OPS['PUSH8']: 1, OPS['PUSH16']: 2, OPS['CH']: 1, OPS['POS']: 1,
+    OPS['EDGE']: 1, OPS['CHANGED']: 1, OPS['LOAD']: 1, OPS['STORE']: 1,
+    OPS['JZ']: 1, OPS['JMP']: 1, OPS['FIRE']: 1,
+}
+
+# Compare operators as (opcode, negate)
+COMPARES = {
+    ast.Lt: ('LT', False), ast.Gt: ('GT', False), ast.Eq: ('EQ', False),
+    ast.GtE: ('LT', True), ast.LtE: ('GT', True), ast.NotEq: ('EQ', True),
+}
+
+
+class CompileError(Exception):
+    def __init__(self, node, message):
+        super().__init__(message)
+        self.line = getattr(node, 'lineno', 0)
+
+
+class Compiler:
+    def __init__(self, channels):
+        self.channels = channels
+        self.max_channel = 0
+        self.max_rule = -1
+        self.code = bytearray()
+        self.variables = {}
+        self.depth = 0
+        self.max_depth = 0
+
+    def emit(self, op, *operands, stack=0):
+        self.code.append(OPS[op])
+        self.code.extend(operands)
+        self.depth += stack
+        self.max_depth = max(self.max_depth, self.depth)
+
+    def constant(self, node, limit):
+        if not isinstance(node, ast.Constant) or not isinstance(node.value, int) \
+                or isinstance(node.value, bool) or not 0 <= node.value <= limit:
+            raise CompileError(node, 'expected an integer constant 0-%d' % limit)
+        return node.value
+
+    def variable(self, node):
+        if node.id not in self.variables:
+            self.variables[node.id] = len(self.variables)
+        return self.variables[node.id]
+
+    def expression(self, node):
+        if isinstance(node, ast.Constant):
+            value = self.constant(node, 0xFFFF)
+            if value <= 0xFF:
+                self.emit('PUSH8', value, stack=1)
+            else:
+                self.emit('PUSH16', value & 0xFF, value >> 8, stack=1)
+        elif isinstance(node, ast.Name) and node.id == 'ms':
+            self.emit('MS', stack=1)
+        elif isinstance(node, ast.Name):
+            self.emit('LOAD', self.variable(node), stack=1)
+        elif isinstance(node, ast.Call) and isinstance(node.func, ast.Name) \
+                and node.func.id in CHANNEL_FUNCS:
+            if len(node.args) != 1 or node.keywords:
+                raise CompileError(node, '%s() takes one channel number' % node.func.id)
+            channel = node.args[0]
+            if not isinstance(channel, ast.Constant) or type(channel.value) is not int \
+                    or not 1 <= channel.value <= self.channels:
+                raise CompileError(node, 'expected a channel 1-%d (IBUS_CHANNELS)' % self.channels)
+            channel = channel.value
+            self.max_channel = max(self.max_channel, channel)
+            self.emit(CHANNEL_FUNCS[node.func.id], channel, stack=1)
+        elif isinstance(node, ast.BinOp) and isinstance(node.op, (ast.Add, ast.Sub)):
+            self.expression(node.left)
+            self.expression(node.right)
+            self.emit('ADD' if isinstance(node.op, ast.Add) else 'SUB', stack=-1)
+        elif isinstance(node, ast.Compare):
+            if len(node.ops) != 1 or type(node.ops[0]) not in COMPARES:
+                raise CompileError(node, 'use a single comparison per operand pair')
+            op, negate = COMPARES[type(node.ops[0])]
+            self.expression(node.left)
+            self.expression(node.comparators[0])
+            self.emit(op, stack=-1)
+            if negate:
+                self.emit('NOT')
+        elif isinstance(node, ast.BoolOp):
+            op = 'AND' if isinstance(node.op, ast.And) else 'OR'
+            self.expression(node.values[0])
+            for value in node.values[1:]:
+                self.expression(value)
+                self.emit(op, stack=-1)
+        elif isinstance(node, ast.UnaryOp) and isinstance(node.op, ast.Not):
+            self.expression(node.operand)
+            self.emit('NOT')
+        else:
+            raise CompileError(node, 'unsupported expression')
+
+    def jump(self, op, stack=0):
+        # Emit a forward jump; returns the operand position to patch
+        self.emit(op, 0, stack=stack)
+        return len(self.code) - 1
+
+    def patch(self, at, node):
+        offset = len(self.code) - (at + 1)
+        if offset > 0xFF:
+            raise CompileError(node, 'if block is too long (over 255 bytes)')
+        self.code[at] = offset
+
+    def statements(self, body):
+        for node in body:
+            self.statement(node)
+
+    def statement(self, node):
+        if isinstance(node, ast.Assign):
+            if len(node.targets) != 1 or not isinstance(node.targets[0], ast.Name) \
+                    or node.targets[0].id == 'ms':
+                raise CompileError(node, 'assign to one variable at a time')
+            self.expression(node.value)
+            self.emit('STORE', self.variable(node.targets[0]), stack=-1)
+        elif isinstance(node, ast.If):
+            self.expression(node.test)
+            skip = self.jump('JZ', stack=-1)
+            self.statements(node.body)
+            if node.orelse:
+                end = self.jump('JMP')
+                self.patch(skip, node)
+                self.statements(node.orelse)
+                self.patch(end, node)
+            else:
+                self.patch(skip, node)
+        elif isinstance(node, ast.Expr) and isinstance(node.value, ast.Call) \
+                and isinstance(node.value.func, ast.Name) and node.value.func.id == 'fire':
+            call = node.value
+            if len(call.args) != 1 or call.keywords:
+                raise CompileError(node, 'fire() takes one rule number')
+            rule = self.constant(call.args[0], 0xFF)  # Checked against the rule table by actions.c
+            self.max_rule = max(self.max_rule, rule)
+            self.emit('FIRE', rule)
+        elif isinstance(node, ast.Pass):
+            pass
+        else:
+            raise CompileError(node, 'unsupported statement')
+
+
+def longest_path(code):
+    # Instructions executed on the longest path from pc 0; jumps only go
+    # forward, so one backward pass over the bytecode covers every branch
+    steps = [0] * (len(code) + 1)
+    starts = []
+    pc = 0
+    while pc < len(code):
+        starts.append(pc)
+        pc += 1 + OPERANDS.get(code[pc], 0)
+    for pc in reversed(starts):
+        op = code[pc]
+        after = pc + 1 + OPERANDS.get(op, 0)
+        if op == OPS['END']:
+            steps[pc] = 1
+        elif op == OPS['JMP']:
+            steps[pc] = 1 + steps[after + code[pc + 1]]
+        elif op == OPS['JZ']:
+            steps[pc] = 1 + max(steps[after], steps[after + code[pc + 1]])
+        else:
+            steps[pc] = 1 + steps[after]
+    return steps[0]
+
+
+def config_value(path, name):
+    with open(path) as f:
+        match = re.search(r'^#define\s+%s\s+(\d+)' % name, f.read(), re.M)
+    if not match:
+        sys.exit('%s: no numeric #define %s' % (path, name))
+    return int(match.group(1))
+
+
+def render(compiler, source, steps):
+    code = bytes(compiler.code)
+    out = []
+    out.append('/**')
+    out.append(' * @file trigger_program.h')
+    out.append(' * @brief Trigger bytecode generated by tools/trigger_compile.py - do not edit')
+    out.append(' *')
+    out.append(' * Generated from %s.' % source)
+    out.append(' * Run `make triggers` after changing the script.')
+    out.append(' *')
+    out.append(' * @copyright Copyright (c) 2025 PIC16F18313 i-Bus Audio Controller Project')
+    out.append(' * @license MIT License - see LICENSE file for details')
+    out.append(' */')
+    out.append('')
+    out.append('#ifndef TRIGGER_PROGRAM_H')
+    out.append('#define TRIGGER_PROGRAM_H')
+    out.append('')
+    out.append('#include "trigger_vm.h"')
+    out.append('')
+    out.append('#define TRIGGER_PROGRAM_SIZE %d' % len(code))
+    out.append('#define TRIGGER_PROGRAM_VARS %d' % len(compiler.variables))
+    out.append('#define TRIGGER_PROGRAM_STACK %d' % compiler.max_depth)
+    out.append('#define TRIGGER_PROGRAM_STEPS %d' % steps)
+    out.append('#define TRIGGER_PROGRAM_MAX_CHANNEL %d' % compiler.max_channel)
+    out.append('#define TRIGGER_PROGRAM_MAX_RULE %d  // -1 = no fire()' % compiler.max_rule)
+    for name, index in compiler.variables.items():
+        out.append('// var %d: %s' % (index, name))
+    out.append('')
+    out.append('// actions.c only needs the limits above')
+    out.append('#ifndef TRIGGER_PROGRAM_LIMITS_ONLY')
+    out.append('static const uint8_t trigger_program[TRIGGER_PROGRAM_SIZE] = {')
+    for start in range(0, len(code), 12):
+        out.append('    ' + ', '.join('0x%02X' % b for b in code[start:start + 12]) + ',')
+    out.append('};')
+    out.append('#endif')
+    out.append('')
+    out.append('#endif // TRIGGER_PROGRAM_H')
+    return '\n'.join(out) + '\n'
+
+
+def compile_script(path, channels, max_steps):
+    with open(path) as f:
+        text = f.read()
+    try:
+        tree = ast.parse(text, path)
+    except SyntaxError as e:
+        sys.exit('%s:%d: %s' % (path, e.lineno or 0, e.msg))
+    compiler = Compiler(channels)
+    try:
+        compiler.statements(tree.body)
+    except CompileError as e:
+        sys.exit('%s:%d: %s' % (path, e.line, e))
+    compiler.emit('END')
+    if len(compiler.code) > 255:
+        sys.exit('%s: program is %d bytes; the VM addresses 255' % (path, len(compiler.code)))
+    steps = longest_path(compiler.code)
+    if steps > max_steps:
+        sys.exit('%s: longest path runs %d instructions; TRIGGER_VM_MAX_STEPS is %d'
+                 % (path, steps, max_steps))
+    return compiler, steps
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit(__doc__.strip().splitlines()[2])
+    script, output = argv[1:]
+    config = os.path.join(os.path.dirname(output), 'config.h')
+    compiler, steps = compile_script(script, config_value(config, 'IBUS_CHANNELS'),
+                                     config_value(config, 'TRIGGER_VM_MAX_STEPS'))
+    with open(output, 'w', newline='\n') as f:
+        f.write(render(compiler, os.path.basename(script), steps))
+
+
+if __name__ == '__main__':
+    main(sys.argv)